@@ -0,0 +1,678 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_ASYNC_FILE_HPP_INCLUDED
+#define NOWIDE_ASYNC_FILE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <nowide/config.hpp>
+#include <nowide/fd_filebuf.hpp>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef NOWIDE_WINDOWS
+#include <nowide/convert.hpp>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// The probe API and the open, read, write and close operations are available since Linux 5.6
+#ifdef IO_URING_OP_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define NOWIDE_HAS_IO_URING
+#endif
+#endif
+
+namespace nowide {
+///
+/// \brief Implementation used by an async_file
+///
+enum class async_file_backend
+{
+    /// io_uring if available, otherwise a thread pool
+    automatic,
+    /// io_uring on Linux, which falls back to a thread pool if it isn't supported by the kernel
+    io_uring,
+    /// Threads running the blocking system calls
+    thread_pool
+};
+
+/// \cond INTERNAL
+namespace detail {
+#ifdef NOWIDE_WINDOWS
+    using async_path = std::wstring;
+    NOWIDE_DECL std::ptrdiff_t fd_pread(int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept;
+    NOWIDE_DECL std::ptrdiff_t fd_pwrite(int fd, const void* buffer, std::size_t size, std::uint64_t offset) noexcept;
+#else
+    using async_path = std::string;
+    /// Read at \a offset without moving the file position, return the number of bytes or -errno
+    inline std::ptrdiff_t fd_pread(int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept
+    {
+        ssize_t result;
+        do
+            result = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+        while(result < 0 && errno == EINTR);
+        return result < 0 ? -errno : result;
+    }
+    /// Write at \a offset without moving the file position, return the number of bytes or -errno
+    inline std::ptrdiff_t fd_pwrite(int fd, const void* buffer, std::size_t size, std::uint64_t offset) noexcept
+    {
+        ssize_t result;
+        do
+            result = ::pwrite(fd, buffer, size, static_cast<off_t>(offset));
+        while(result < 0 && errno == EINTR);
+        return result < 0 ? -errno : result;
+    }
+#endif
+
+    /// Results are an int like for io_uring, so transfers are limited to this size
+    constexpr std::size_t max_async_transfer = INT_MAX & ~std::size_t(4095);
+
+    struct async_operation
+    {
+        enum class kind
+        {
+            open,
+            read,
+            write,
+            close
+        };
+        kind type;
+        int fd;
+        void* buffer;
+        std::size_t size;
+        std::uint64_t offset;
+        int flags;
+        async_path path;
+        std::function<void(int)> callback;
+    };
+    using async_completion = std::pair<async_operation*, int>;
+
+    /// Run \a op synchronously and return its result
+    inline int run_operation(const async_operation& op) noexcept
+    {
+        switch(op.type)
+        {
+        case async_operation::kind::open:
+        {
+            const int fd = fd_open(op.path.c_str(), op.flags);
+            return fd < 0 ? -errno : fd;
+        }
+        case async_operation::kind::read: return static_cast<int>(fd_pread(op.fd, op.buffer, op.size, op.offset));
+        case async_operation::kind::write: return static_cast<int>(fd_pwrite(op.fd, op.buffer, op.size, op.offset));
+        case async_operation::kind::close: return fd_close(op.fd) == 0 ? 0 : -errno;
+        }
+        return -EINVAL;
+    }
+
+    class async_backend
+    {
+    public:
+        virtual ~async_backend() = default;
+        /// Queue \a op for the next submit()
+        virtual void queue(async_operation* op) = 0;
+        /// Start all queued operations
+        virtual void submit() = 0;
+        /// Append finished operations to \a done, if \a wait is true wait for at least one
+        virtual void reap(std::deque<async_completion>& done, bool wait) = 0;
+    };
+
+    class thread_pool_async_backend final : public async_backend
+    {
+    public:
+        explicit thread_pool_async_backend(unsigned thread_count) : thread_count_(thread_count)
+        {}
+        ~thread_pool_async_backend() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            jobs_changed_.notify_all();
+            for(std::thread& thread : threads_)
+                thread.join();
+        }
+        void queue(async_operation* op) override
+        {
+            queued_.push_back(op);
+        }
+        void submit() override
+        {
+            if(queued_.empty())
+                return;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                jobs_.insert(jobs_.end(), queued_.begin(), queued_.end());
+            }
+            queued_.clear();
+            // Threads are started on first use
+            while(threads_.size() < thread_count_)
+                threads_.emplace_back([this] { work(); });
+            jobs_changed_.notify_all();
+        }
+        void reap(std::deque<async_completion>& done, bool wait) override
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(wait)
+                completed_changed_.wait(lock, [this] { return !completed_.empty(); });
+            done.insert(done.end(), completed_.begin(), completed_.end());
+            completed_.clear();
+        }
+
+    private:
+        void work()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for(;;)
+            {
+                jobs_changed_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+                if(jobs_.empty())
+                    return;
+                async_operation* const op = jobs_.front();
+                jobs_.pop_front();
+                lock.unlock();
+                const int result = run_operation(*op);
+                lock.lock();
+                completed_.emplace_back(op, result);
+                completed_changed_.notify_one();
+            }
+        }
+
+        const unsigned thread_count_;
+        std::vector<async_operation*> queued_;
+        std::mutex mutex_;
+        std::condition_variable jobs_changed_, completed_changed_;
+        std::deque<async_operation*> jobs_;
+        std::vector<async_completion> completed_;
+        bool stop_{false};
+        std::vector<std::thread> threads_;
+    };
+
+#ifdef NOWIDE_HAS_IO_URING
+    ///
+    /// Backend using an io_uring directly through its system calls
+    ///
+    class io_uring_async_backend final : public async_backend
+    {
+    public:
+        /// Set up a ring with at least \a entries submission queue entries, check is_valid() for success
+        explicit io_uring_async_backend(unsigned entries)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if(ring_fd_ < 0)
+                return;
+            // The single mapping of both rings is available since Linux 5.4
+            if(!(params.features & IORING_FEAT_SINGLE_MMAP) || !supports_operations())
+                return;
+            sq_entries_ = params.sq_entries;
+            cq_entries_ = params.cq_entries;
+            ring_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                  params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+            void* const ring = ::mmap(
+              nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+            if(ring == MAP_FAILED)
+                return;
+            ring_ = static_cast<char*>(ring);
+            void* const sqes = ::mmap(nullptr,
+                                      params.sq_entries * sizeof(io_uring_sqe),
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE,
+                                      ring_fd_,
+                                      IORING_OFF_SQES);
+            if(sqes == MAP_FAILED)
+                return;
+            sqes_ = static_cast<io_uring_sqe*>(sqes);
+            sq_head_ = reinterpret_cast<unsigned*>(ring_ + params.sq_off.head);
+            sq_tail_ = reinterpret_cast<unsigned*>(ring_ + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned*>(ring_ + params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned*>(ring_ + params.sq_off.array);
+            cq_head_ = reinterpret_cast<unsigned*>(ring_ + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(ring_ + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned*>(ring_ + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(ring_ + params.cq_off.cqes);
+            tail_ = *sq_tail_;
+        }
+        ~io_uring_async_backend() override
+        {
+            if(sqes_)
+                ::munmap(sqes_, sq_entries_ * sizeof(io_uring_sqe));
+            if(ring_)
+                ::munmap(ring_, ring_size_);
+            if(ring_fd_ >= 0)
+                ::close(ring_fd_);
+        }
+        bool is_valid() const noexcept
+        {
+            return sqes_ != nullptr;
+        }
+
+        void queue(async_operation* op) override
+        {
+            // Never start more operations than the completion queue can hold
+            if(in_flight_ == cq_entries_)
+                collect_waiting(overflow_);
+            if(in_flight_ < cq_entries_ && sq_full())
+                enter(0, 0);
+            if(in_flight_ == cq_entries_ || sq_full())
+            {
+                // The ring can't take it, run it right away instead of overwriting an entry the kernel didn't consume
+                overflow_.emplace_back(op, run_operation(*op));
+                return;
+            }
+            const unsigned index = tail_ & sq_mask_;
+            io_uring_sqe& sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            switch(op->type)
+            {
+            case async_operation::kind::open:
+                sqe.opcode = IORING_OP_OPENAT;
+                sqe.fd = AT_FDCWD;
+                sqe.addr = reinterpret_cast<std::uintptr_t>(op->path.c_str());
+                sqe.len = 0666;
+                sqe.open_flags = static_cast<unsigned>(op->flags | O_CLOEXEC);
+                break;
+            case async_operation::kind::read:
+            case async_operation::kind::write:
+                sqe.opcode = op->type == async_operation::kind::read ? IORING_OP_READ : IORING_OP_WRITE;
+                sqe.fd = op->fd;
+                sqe.addr = reinterpret_cast<std::uintptr_t>(op->buffer);
+                sqe.len = static_cast<unsigned>(op->size);
+                sqe.off = op->offset;
+                break;
+            case async_operation::kind::close:
+                sqe.opcode = IORING_OP_CLOSE;
+                sqe.fd = op->fd;
+                break;
+            }
+            sqe.user_data = reinterpret_cast<std::uintptr_t>(op);
+            sq_array_[index] = index;
+            tail_++;
+            to_submit_++;
+            in_flight_++;
+        }
+        void submit() override
+        {
+            if(to_submit_)
+                enter(0, 0);
+        }
+        void reap(std::deque<async_completion>& done, bool wait) override
+        {
+            done.insert(done.end(), overflow_.begin(), overflow_.end());
+            const bool found = !overflow_.empty();
+            overflow_.clear();
+            if(!collect(done) && !found && wait)
+                collect_waiting(done);
+        }
+
+    private:
+        /// Check that the kernel supports all operations used
+        bool supports_operations() const
+        {
+            constexpr unsigned max_ops = 256;
+            std::vector<unsigned char> buffer(sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op));
+            io_uring_probe* const probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+            if(::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, max_ops) < 0)
+                return false;
+            for(unsigned op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE})
+            {
+                if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                    return false;
+            }
+            return true;
+        }
+
+        bool sq_full() const noexcept
+        {
+            return tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_;
+        }
+        /// Submit queued entries and wait for \a min_complete completions, return 0 or -errno
+        int enter(unsigned min_complete, unsigned flags)
+        {
+            __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+            for(;;)
+            {
+                const long result =
+                  ::syscall(__NR_io_uring_enter, ring_fd_, to_submit_, min_complete, flags, nullptr, 0);
+                if(result >= 0)
+                {
+                    to_submit_ -= static_cast<unsigned>(result);
+                    return 0;
+                }
+                if(errno != EINTR)
+                    return -errno;
+            }
+        }
+        /// Complete the queued entries the kernel didn't consume with \a error and remove them from the ring
+        template<typename Container>
+        void fail_unsubmitted(Container& done, int error)
+        {
+            // The kernel reads the submission queue only in io_uring_enter, so the tail can be moved back
+            const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            for(unsigned i = head; i != tail_; i++)
+            {
+                done.emplace_back(reinterpret_cast<async_operation*>(sqes_[sq_array_[i & sq_mask_]].user_data), error);
+                in_flight_--;
+            }
+            tail_ = head;
+            to_submit_ = 0;
+            __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+        }
+        /// Move all available completions to \a done and return true if there were any
+        bool collect(std::deque<async_completion>& done)
+        {
+            unsigned head = *cq_head_;
+            const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            if(head == tail)
+                return false;
+            for(; head != tail; head++)
+            {
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                done.emplace_back(reinterpret_cast<async_operation*>(cqe.user_data), cqe.res);
+                in_flight_--;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            return true;
+        }
+        /// Wait for completions and move them to \a done, on errors of the ring fail the entries it didn't consume
+        template<typename Container>
+        void collect_waiting(Container& done)
+        {
+            std::deque<async_completion> completions;
+            while(!collect(completions))
+            {
+                const int error = enter(1, IORING_ENTER_GETEVENTS);
+                if(error < 0 && !collect(completions))
+                {
+                    fail_unsubmitted(completions, error);
+                    break;
+                }
+            }
+            done.insert(done.end(), completions.begin(), completions.end());
+        }
+
+        int ring_fd_{-1};
+        char* ring_{nullptr};
+        std::size_t ring_size_{0};
+        io_uring_sqe* sqes_{nullptr};
+        unsigned sq_entries_{0}, cq_entries_{0};
+        unsigned *sq_head_{nullptr}, *sq_tail_{nullptr}, *sq_array_{nullptr};
+        unsigned *cq_head_{nullptr}, *cq_tail_{nullptr};
+        unsigned sq_mask_{0}, cq_mask_{0};
+        io_uring_cqe* cqes_{nullptr};
+        /// Local tail of the submission queue, published on the next enter()
+        unsigned tail_{0};
+        unsigned to_submit_{0};
+        /// Operations queued and not yet collected
+        unsigned in_flight_{0};
+        /// Completions collected to make room in the completion queue
+        std::vector<async_completion> overflow_;
+    };
+#endif
+} // namespace detail
+/// \endcond
+
+///
+/// \brief Batches of asynchronous open, read, write and close operations on files
+///
+/// Operations are queued with a callback receiving the result, or return a std::future of it.
+/// The result is like the return value of the system call or -errno on failure: the file descriptor for open,
+/// the number of bytes transferred for read and write, which may be less than requested like for pread,
+/// and 0 for close. Reads and writes are positional and don't move the file position.
+///
+/// Queued operations are started together by submit(), poll() or wait(). Callbacks run and futures become ready
+/// only in the thread calling poll(), wait() or wait_all(), callbacks may queue further operations.
+/// Buffers must stay valid until the operation finished.
+///
+/// On Linux io_uring is used if supported by the kernel, otherwise, and on other systems, a pool of threads
+/// runs the blocking calls. File names are UTF-8 on all platforms.
+///
+class async_file
+{
+public:
+    using callback = std::function<void(int result)>;
+
+    ///
+    /// Create a queue for about \a queue_depth operations at once, using \a backend if available
+    ///
+    explicit async_file(unsigned queue_depth = 256, async_file_backend backend = async_file_backend::automatic)
+    {
+        queue_depth = std::max(queue_depth, 1u);
+#ifdef NOWIDE_HAS_IO_URING
+        if(backend != async_file_backend::thread_pool)
+        {
+            auto ring = std::make_unique<detail::io_uring_async_backend>(queue_depth);
+            if(ring->is_valid())
+            {
+                backend_ = std::move(ring);
+                backend_type_ = async_file_backend::io_uring;
+                return;
+            }
+        }
+#else
+        (void)backend;
+#endif
+        backend_ = std::make_unique<detail::thread_pool_async_backend>(std::min(queue_depth, 16u));
+        backend_type_ = async_file_backend::thread_pool;
+    }
+    async_file(const async_file&) = delete;
+    async_file& operator=(const async_file&) = delete;
+    ///
+    /// Wait until all started operations finished without running their callbacks
+    ///
+    /// Files opened by them are not closed.
+    ///
+    ~async_file()
+    {
+        backend_->submit();
+        while(pending_ > ready_.size())
+            backend_->reap(ready_, true);
+        for(const detail::async_completion& completion : ready_)
+            delete completion.first;
+    }
+
+    /// Return the backend used, either async_file_backend::io_uring or async_file_backend::thread_pool
+    async_file_backend backend() const noexcept
+    {
+        return backend_type_;
+    }
+    /// Return the number of operations whose callbacks didn't run yet
+    std::size_t pending() const noexcept
+    {
+        return pending_;
+    }
+
+    ///
+    /// Open \a file_name with \a mode like std::filebuf, the result is the file descriptor
+    ///
+    void open(const char* file_name, std::ios_base::openmode mode, callback cb)
+    {
+        std::unique_ptr<detail::async_operation> op =
+          make_operation(detail::async_operation::kind::open, std::move(cb));
+        op->flags = detail::fd_open_flags(mode);
+#ifdef NOWIDE_WINDOWS
+        op->path = widen(file_name);
+#else
+        op->path = file_name;
+#endif
+        if(op->flags < 0)
+            finish(std::move(op), -EINVAL);
+        else
+            queue(std::move(op));
+    }
+    void open(const std::string& file_name, std::ios_base::openmode mode, callback cb)
+    {
+        open(file_name.c_str(), mode, std::move(cb));
+    }
+    ///
+    /// Read up to \a size bytes at \a offset of the file \a fd into \a buffer, the result is the number read
+    ///
+    void read(int fd, void* buffer, std::size_t size, std::uint64_t offset, callback cb)
+    {
+        queue_transfer(detail::async_operation::kind::read, fd, buffer, size, offset, std::move(cb));
+    }
+    ///
+    /// Write up to \a size bytes from \a buffer at \a offset of the file \a fd, the result is the number written
+    ///
+    void write(int fd, const void* buffer, std::size_t size, std::uint64_t offset, callback cb)
+    {
+        queue_transfer(
+          detail::async_operation::kind::write, fd, const_cast<void*>(buffer), size, offset, std::move(cb));
+    }
+    ///
+    /// Close the file \a fd
+    ///
+    void close(int fd, callback cb)
+    {
+        std::unique_ptr<detail::async_operation> op =
+          make_operation(detail::async_operation::kind::close, std::move(cb));
+        op->fd = fd;
+        queue(std::move(op));
+    }
+
+    std::future<int> open(const char* file_name, std::ios_base::openmode mode)
+    {
+        return with_future([&](callback cb) { open(file_name, mode, std::move(cb)); });
+    }
+    std::future<int> open(const std::string& file_name, std::ios_base::openmode mode)
+    {
+        return open(file_name.c_str(), mode);
+    }
+    std::future<int> read(int fd, void* buffer, std::size_t size, std::uint64_t offset)
+    {
+        return with_future([&](callback cb) { read(fd, buffer, size, offset, std::move(cb)); });
+    }
+    std::future<int> write(int fd, const void* buffer, std::size_t size, std::uint64_t offset)
+    {
+        return with_future([&](callback cb) { write(fd, buffer, size, offset, std::move(cb)); });
+    }
+    std::future<int> close(int fd)
+    {
+        return with_future([&](callback cb) { close(fd, std::move(cb)); });
+    }
+
+    /// Start all queued operations
+    void submit()
+    {
+        backend_->submit();
+    }
+    ///
+    /// Start all queued operations and run the callbacks of finished ones without waiting
+    ///
+    /// \return the number of callbacks run
+    ///
+    std::size_t poll()
+    {
+        backend_->submit();
+        backend_->reap(ready_, false);
+        return run_callbacks();
+    }
+    ///
+    /// Start all queued operations and run the callbacks of finished ones, waiting for at least one if none finished
+    ///
+    /// \return the number of callbacks run, 0 only if there are no pending operations
+    ///
+    std::size_t wait()
+    {
+        if(!pending_)
+            return 0;
+        backend_->submit();
+        backend_->reap(ready_, ready_.empty());
+        return run_callbacks();
+    }
+    /// Wait until all operations, including those queued by callbacks, finished and their callbacks ran
+    void wait_all()
+    {
+        while(pending_)
+            wait();
+    }
+
+private:
+    static std::unique_ptr<detail::async_operation> make_operation(detail::async_operation::kind type, callback cb)
+    {
+        return std::unique_ptr<detail::async_operation>(
+          new detail::async_operation{type, -1, nullptr, 0, 0, 0, {}, std::move(cb)});
+    }
+    template<typename Queue>
+    static std::future<int> with_future(Queue&& queue)
+    {
+        const auto promise = std::make_shared<std::promise<int>>();
+        std::future<int> result = promise->get_future();
+        queue([promise](int value) { promise->set_value(value); });
+        return result;
+    }
+
+    void queue_transfer(detail::async_operation::kind type,
+                        int fd,
+                        void* buffer,
+                        std::size_t size,
+                        std::uint64_t offset,
+                        callback cb)
+    {
+        std::unique_ptr<detail::async_operation> op = make_operation(type, std::move(cb));
+        op->fd = fd;
+        op->buffer = buffer;
+        op->size = std::min(size, detail::max_async_transfer);
+        op->offset = offset;
+        queue(std::move(op));
+    }
+    void queue(std::unique_ptr<detail::async_operation> op)
+    {
+        backend_->queue(op.get());
+        op.release();
+        pending_++;
+    }
+    /// Complete \a op without starting it
+    void finish(std::unique_ptr<detail::async_operation> op, int result)
+    {
+        ready_.emplace_back(op.release(), result);
+        pending_++;
+    }
+
+    std::size_t run_callbacks()
+    {
+        std::size_t count = 0;
+        while(!ready_.empty())
+        {
+            const detail::async_completion completion = ready_.front();
+            ready_.pop_front();
+            pending_--;
+            const callback cb = std::move(completion.first->callback);
+            delete completion.first;
+            count++;
+            if(cb)
+                cb(completion.second);
+        }
+        return count;
+    }
+
+    std::unique_ptr<detail::async_backend> backend_;
+    async_file_backend backend_type_;
+    std::size_t pending_{0};
+    std::deque<detail::async_completion> ready_;
+}; // async_file
+
+} // namespace nowide
+
+#endif
@@ -0,0 +1,563 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_ATOMIC_WRITER_HPP_INCLUDED
+#define NOWIDE_ATOMIC_WRITER_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <nowide/config.hpp>
+#include <nowide/convert.hpp>
+#include <nowide/fd_filebuf.hpp>
+#include <nowide/filesystem.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#ifndef NOWIDE_WINDOWS
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nowide {
+/// \cond INTERNAL
+namespace detail {
+    /// How files opened by fd_open_unnamed are linked: 0 if not known yet, 1 by descriptor, 2 by their path in
+    /// /proc, -1 if they can't be
+    inline std::atomic<int>& unnamed_link_method() noexcept
+    {
+        static std::atomic<int> method{0};
+        return method;
+    }
+
+#ifdef NOWIDE_WINDOWS
+    using native_string = std::wstring;
+
+    /// Make the content of \a fd durable, return false on error
+    inline bool fd_sync(int fd) noexcept
+    {
+        return ::_commit(fd) == 0;
+    }
+    /// Return an id of the file system of \a fd whose files are made durable together, or -1 if there is none
+    inline std::int64_t fd_file_system(int /*fd*/) noexcept
+    {
+        return -1;
+    }
+    inline bool fd_sync_file_system(int fd) noexcept
+    {
+        return fd_sync(fd);
+    }
+    /// Unnamed files aren't supported
+    inline int fd_open_unnamed(const wchar_t* /*directory*/) noexcept
+    {
+        return -1;
+    }
+    inline bool fd_link(int /*fd*/, const wchar_t* /*name*/) noexcept
+    {
+        return false;
+    }
+    /// Replaces are written through, see replace_file
+    inline bool sync_directory(const wchar_t* /*name*/) noexcept
+    {
+        return true;
+    }
+    /// The replaced file gets the security descriptor of the new one, e.g. inherited from its directory
+    inline bool fd_copy_mode(int /*fd*/, const wchar_t* /*name*/) noexcept
+    {
+        return true;
+    }
+    /// Replace \a to by \a from and write the change through to the disk, return false on error
+    NOWIDE_DECL bool replace_file(const wchar_t* from, const wchar_t* to) noexcept;
+    NOWIDE_DECL bool remove_file(const wchar_t* name) noexcept;
+    NOWIDE_DECL unsigned long process_id() noexcept;
+#else
+    using native_string = std::string;
+
+    /// Make the content of \a fd durable, return false on error
+    inline bool fd_sync(int fd) noexcept
+    {
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+        return ::fdatasync(fd) == 0;
+#else
+        return ::fsync(fd) == 0;
+#endif
+    }
+#ifdef __linux__
+    /// Return an id of the file system of \a fd whose files are made durable together, or -1 if there is none
+    inline std::int64_t fd_file_system(int fd) noexcept
+    {
+        struct stat st;
+        if(::fstat(fd, &st) != 0)
+            return -1;
+        return static_cast<std::int64_t>(st.st_dev);
+    }
+    /// Make the content of all files on the file system of \a fd durable, return false on error
+    inline bool fd_sync_file_system(int fd) noexcept
+    {
+        return ::syncfs(fd) == 0;
+    }
+#else
+    inline std::int64_t fd_file_system(int /*fd*/) noexcept
+    {
+        return -1;
+    }
+    inline bool fd_sync_file_system(int fd) noexcept
+    {
+        return fd_sync(fd);
+    }
+#endif
+    /// Open a file without a name in \a directory for writing, return -1 on failure
+    inline int fd_open_unnamed(const char* directory) noexcept
+    {
+#ifdef O_TMPFILE
+        return fd_open(directory, O_TMPFILE | O_WRONLY);
+#else
+        (void)directory;
+        return -1;
+#endif
+    }
+    /// Give the file \a fd opened by fd_open_unnamed the \a name, fails if the name exists
+    inline bool fd_link(int fd, const char* name) noexcept
+    {
+#ifdef O_TMPFILE
+        // Linking the descriptor needs CAP_DAC_READ_SEARCH before Linux 6.10, its path needs /proc mounted
+        std::atomic<int>& method = unnamed_link_method();
+#ifdef AT_EMPTY_PATH
+        if(method.load(std::memory_order_relaxed) != 2)
+        {
+            if(::linkat(fd, "", AT_FDCWD, name, AT_EMPTY_PATH) == 0)
+            {
+                method.store(1, std::memory_order_relaxed);
+                return true;
+            }
+            if(errno == EEXIST || method.load(std::memory_order_relaxed) == 1)
+                return false;
+        }
+#endif
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        if(::linkat(AT_FDCWD, path, AT_FDCWD, name, AT_SYMLINK_FOLLOW) != 0)
+            return false;
+        method.store(2, std::memory_order_relaxed);
+        return true;
+#else
+        (void)fd;
+        (void)name;
+        errno = ENOSYS;
+        return false;
+#endif
+    }
+    /// Make the entries of the directory \a name durable, return false on error
+    inline bool sync_directory(const char* name) noexcept
+    {
+        const int fd = fd_open(name, O_RDONLY | O_DIRECTORY);
+        if(fd < 0)
+            return false;
+        const bool result = ::fsync(fd) == 0;
+        fd_close(fd);
+        return result;
+    }
+    /// Give the file \a fd the permissions of the file \a name if it exists, return false on error
+    inline bool fd_copy_mode(int fd, const char* name) noexcept
+    {
+        struct stat st;
+        if(::stat(name, &st) != 0)
+            return errno == ENOENT;
+        return ::fchmod(fd, st.st_mode & 07777) == 0;
+    }
+    inline bool replace_file(const char* from, const char* to) noexcept
+    {
+        return std::rename(from, to) == 0;
+    }
+    inline bool remove_file(const char* name) noexcept
+    {
+        return ::unlink(name) == 0;
+    }
+    inline unsigned long process_id() noexcept
+    {
+        return static_cast<unsigned long>(::getpid());
+    }
+#endif
+
+    /// Return the directory containing the file \a name
+    inline native_string directory_of(const native_string& name)
+    {
+#ifdef NOWIDE_WINDOWS
+        const std::size_t pos = name.find_last_of(L"/\\");
+#else
+        const std::size_t pos = name.find_last_of('/');
+#endif
+        if(pos == native_string::npos)
+            return native_string(1, '.');
+        return name.substr(0, pos ? pos : 1);
+    }
+} // namespace detail
+/// \endcond
+
+class atomic_batch;
+
+///
+/// \brief Replace the content of a file atomically and durably
+///
+/// The new content is written to a temporary file in the same directory, which replaces the file by a rename
+/// on commit(), so readers see either the old or the whole new content, also after a crash. Where supported,
+/// e.g. with O_TMPFILE on Linux, the temporary file has no name until it is committed, so nothing is left
+/// behind if the process dies before. Whether such files can be linked, which may need /proc, is checked once
+/// per process. File names are UTF-8 on all platforms.
+///
+/// Committing a single file waits for both its content and its directory entry to reach the disk.
+/// Use commit(atomic_batch&) to commit many files with one wait for each, see atomic_batch.
+///
+/// A replaced file keeps its permissions, which the temporary file gets when the writer is opened, so its content
+/// is never accessible more widely. Its owner isn't kept.
+///
+class atomic_writer
+{
+public:
+    atomic_writer() = default;
+    explicit atomic_writer(const char* file_name)
+    {
+        open(file_name);
+    }
+    explicit atomic_writer(const std::string& file_name)
+    {
+        open(file_name);
+    }
+#ifdef NOWIDE_WINDOWS
+    explicit atomic_writer(const wchar_t* file_name)
+    {
+        open(file_name);
+    }
+#endif
+    explicit atomic_writer(const filesystem::path& file_name)
+    {
+        open(file_name);
+    }
+    atomic_writer(const atomic_writer&) = delete;
+    atomic_writer& operator=(const atomic_writer&) = delete;
+    atomic_writer(atomic_writer&& other) noexcept :
+        fd_(std::exchange(other.fd_, -1)), name_(std::move(other.name_)), temp_name_(std::move(other.temp_name_))
+    {
+        other.name_.clear();
+        other.temp_name_.clear();
+    }
+    atomic_writer& operator=(atomic_writer&& rhs) noexcept
+    {
+        swap(rhs);
+        rhs.abort();
+        return *this;
+    }
+    /// Discard the content if it wasn't committed
+    ~atomic_writer()
+    {
+        abort();
+    }
+    void swap(atomic_writer& other) noexcept
+    {
+        std::swap(fd_, other.fd_);
+        name_.swap(other.name_);
+        temp_name_.swap(other.temp_name_);
+    }
+
+    ///
+    /// Start replacing the file \a file_name, which doesn't need to exist
+    ///
+    /// \return false if the temporary file couldn't be created or given the permissions of the file, or a file
+    /// is already open
+    ///
+    bool open(const char* file_name)
+    {
+#ifdef NOWIDE_WINDOWS
+        return open_native(widen(file_name));
+#else
+        return open_native(file_name);
+#endif
+    }
+    bool open(const std::string& file_name)
+    {
+        return open(file_name.c_str());
+    }
+#ifdef NOWIDE_WINDOWS
+    bool open(const wchar_t* file_name)
+    {
+        return open_native(file_name);
+    }
+#endif
+    bool open(const filesystem::path& file_name)
+    {
+        return open_native(file_name.native());
+    }
+    bool is_open() const noexcept
+    {
+        return fd_ >= 0;
+    }
+
+    ///
+    /// Append \a size bytes at \a data to the new content
+    ///
+    /// Each call is a system call, so pass large blocks, e.g. the whole content at once.
+    ///
+    /// \return false if no file is open or writing failed
+    ///
+    bool write(const void* data, std::size_t size) noexcept
+    {
+        if(fd_ < 0)
+            return false;
+        const char* pos = static_cast<const char*>(data);
+        while(size)
+        {
+            const std::ptrdiff_t written = detail::fd_write(fd_, pos, size);
+            if(written <= 0)
+                return false;
+            pos += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+    bool write(std::string_view data) noexcept
+    {
+        return write(data.data(), data.size());
+    }
+
+    ///
+    /// Replace the file by the new content and wait until the change is durable
+    ///
+    /// The writer is closed afterwards in any case.
+    ///
+    /// \return false if no file is open or the file couldn't be replaced, it is unchanged then,
+    /// or if the replacement couldn't be made durable
+    ///
+    bool commit()
+    {
+        if(fd_ < 0)
+            return false;
+        const native_string directory = detail::directory_of(name_);
+        const bool result = detail::fd_sync(fd_) && publish() && detail::sync_directory(directory.c_str());
+        abort();
+        return result;
+    }
+    ///
+    /// Move the new content into \a batch, which replaces the file on atomic_batch::commit()
+    ///
+    /// The writer is closed afterwards.
+    ///
+    /// \return false if no file is open
+    ///
+    bool commit(atomic_batch& batch);
+
+    ///
+    /// Discard the new content and close the writer, the file stays unchanged
+    ///
+    void abort() noexcept
+    {
+        if(fd_ >= 0)
+            detail::fd_close(fd_);
+        fd_ = -1;
+        if(!temp_name_.empty())
+            detail::remove_file(temp_name_.c_str());
+        name_.clear();
+        temp_name_.clear();
+    }
+
+private:
+    friend class atomic_batch;
+    using native_string = detail::native_string;
+
+    bool open_native(native_string file_name)
+    {
+        if(fd_ >= 0)
+            return false;
+        name_ = std::move(file_name);
+        fd_ = detail::fd_open_unnamed(detail::directory_of(name_).c_str());
+        if(fd_ >= 0 && !can_link_unnamed())
+        {
+            detail::fd_close(fd_);
+            fd_ = -1;
+        }
+        if(fd_ < 0)
+        {
+            with_temporary_name([this]() {
+                fd_ = detail::fd_open(temp_name_.c_str(), detail::fd_wronly | detail::fd_creat | detail::fd_excl);
+                return fd_ >= 0;
+            });
+        }
+        if(fd_ < 0)
+            name_.clear();
+        else if(!detail::fd_copy_mode(fd_, name_.c_str()))
+            abort();
+        return fd_ >= 0;
+    }
+
+    ///
+    /// Return true if the unnamed fd_ can be linked on commit
+    ///
+    /// This is checked once by linking it to a temporary name, which it keeps as it can't be unnamed again.
+    ///
+    bool can_link_unnamed()
+    {
+        const int method = detail::unnamed_link_method().load(std::memory_order_relaxed);
+        if(method)
+            return method > 0;
+        if(with_temporary_name([this]() { return detail::fd_link(fd_, temp_name_.c_str()); }))
+            return true;
+        detail::unnamed_link_method().store(-1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /// Call \a create with temp_name_ set to unused names until it succeeds or fails for another reason
+    template<typename Function>
+    bool with_temporary_name(Function create)
+    {
+        static std::atomic<unsigned long> counter{0};
+        for(int attempt = 0; attempt < 100; attempt++)
+        {
+            const std::string suffix =
+              ".tmp." + std::to_string(detail::process_id()) + "." + std::to_string(counter++);
+            temp_name_ = name_;
+            temp_name_.append(suffix.begin(), suffix.end());
+            if(create())
+                return true;
+            if(errno != EEXIST)
+                break;
+        }
+        temp_name_.clear();
+        return false;
+    }
+
+    /// Replace the file by the written content and close it, return false if it is unchanged
+    bool publish()
+    {
+        bool result;
+        if(temp_name_.empty())
+        {
+            // An unnamed file is linked directly if the file doesn't exist, otherwise renamed over it
+            result = detail::fd_link(fd_, name_.c_str());
+            if(!result && errno == EEXIST)
+            {
+                result = with_temporary_name([this]() { return detail::fd_link(fd_, temp_name_.c_str()); })
+                         && detail::replace_file(temp_name_.c_str(), name_.c_str());
+            }
+        } else
+        {
+#ifdef NOWIDE_WINDOWS
+            // Open files can't be replaced
+            detail::fd_close(fd_);
+            fd_ = -1;
+#endif
+            result = detail::replace_file(temp_name_.c_str(), name_.c_str());
+        }
+        if(result)
+            temp_name_.clear();
+        return result;
+    }
+
+    int fd_{-1};
+    native_string name_;
+    /// Name of the temporary file if it has one
+    native_string temp_name_;
+}; // atomic_writer
+
+inline void swap(atomic_writer& lhs, atomic_writer& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+///
+/// \brief Files written by atomic_writer%s which are replaced together
+///
+/// commit() waits once per file system for the content of all files to reach the disk, e.g. with syncfs on
+/// Linux, then replaces the files and waits once per directory for the changed entries. So committing many
+/// files, e.g. the state of a checkpoint, costs about as much as committing one. Each file is still replaced
+/// atomically, but not all of them at once: after a crash some may have been replaced and others not.
+///
+class atomic_batch
+{
+public:
+    atomic_batch() = default;
+    atomic_batch(const atomic_batch&) = delete;
+    atomic_batch& operator=(const atomic_batch&) = delete;
+    /// Discard files which weren't committed
+    ~atomic_batch() = default;
+
+    /// Return the number of files to be replaced
+    std::size_t size() const noexcept
+    {
+        return writers_.size();
+    }
+    bool empty() const noexcept
+    {
+        return writers_.empty();
+    }
+
+    ///
+    /// Replace all files and wait until the changes are durable, the batch is empty afterwards
+    ///
+    /// \return false if any file couldn't be replaced or the changes couldn't be made durable.
+    /// If the content couldn't be made durable, no file is replaced.
+    ///
+    bool commit()
+    {
+        std::vector<std::int64_t> file_systems;
+        for(const atomic_writer& writer : writers_)
+        {
+            const std::int64_t file_system = detail::fd_file_system(writer.fd_);
+            if(file_system >= 0)
+            {
+                if(std::find(file_systems.begin(), file_systems.end(), file_system) != file_systems.end())
+                    continue;
+                file_systems.push_back(file_system);
+            }
+            if(!detail::fd_sync_file_system(writer.fd_))
+            {
+                abort();
+                return false;
+            }
+        }
+        bool result = true;
+        std::vector<detail::native_string> directories;
+        for(atomic_writer& writer : writers_)
+        {
+            if(writer.publish())
+            {
+                detail::native_string directory = detail::directory_of(writer.name_);
+                if(std::find(directories.begin(), directories.end(), directory) == directories.end())
+                    directories.push_back(std::move(directory));
+            } else
+                result = false;
+        }
+        abort();
+        for(const detail::native_string& directory : directories)
+            result = detail::sync_directory(directory.c_str()) && result;
+        return result;
+    }
+    /// Discard all files, leaving them unchanged
+    void abort() noexcept
+    {
+        writers_.clear();
+    }
+
+private:
+    friend class atomic_writer;
+    std::vector<atomic_writer> writers_;
+}; // atomic_batch
+
+inline bool atomic_writer::commit(atomic_batch& batch)
+{
+    if(fd_ < 0)
+        return false;
+    batch.writers_.push_back(std::move(*this));
+    return true;
+}
+
+} // namespace nowide
+
+#endif
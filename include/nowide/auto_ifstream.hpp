@@ -0,0 +1,328 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_AUTO_IFSTREAM_HPP_INCLUDED
+#define NOWIDE_AUTO_IFSTREAM_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <nowide/filebuf.hpp>
+#include <nowide/utf/convert.hpp>
+#include <nowide/utf/endian.hpp>
+#include <streambuf>
+#include <string>
+
+namespace nowide {
+///
+/// \brief Encodings of text detected by detect_encoding()
+///
+enum class text_encoding
+{
+    utf8,
+    utf16le,
+    utf16be,
+    utf32le,
+    utf32be
+};
+
+///
+/// Detect the encoding of the text starting with the bytes [begin, end)
+///
+/// A byte order mark is used if present and its length is stored in \a bom_length, otherwise it is set to 0.
+/// Without a BOM the encoding is guessed from the positions of zero bytes, which are rare in text but frequent
+/// in UTF-16/32 encoded ASCII characters. UTF-8 is assumed if in doubt.
+///
+inline text_encoding detect_encoding(const char* begin, const char* end, std::size_t& bom_length) noexcept
+{
+    const unsigned char* const p = reinterpret_cast<const unsigned char*>(begin);
+    const std::size_t size = end - begin;
+    struct bom_type
+    {
+        const char* bytes;
+        std::size_t length;
+        text_encoding encoding;
+    };
+    // UTF-32LE before UTF-16LE as they share the first 2 bytes
+    const bom_type boms[] = {{"\xEF\xBB\xBF", 3, text_encoding::utf8},
+                             {"\xFF\xFE\0\0", 4, text_encoding::utf32le},
+                             {"\0\0\xFE\xFF", 4, text_encoding::utf32be},
+                             {"\xFF\xFE", 2, text_encoding::utf16le},
+                             {"\xFE\xFF", 2, text_encoding::utf16be}};
+    for(const bom_type& bom : boms)
+    {
+        if(size >= bom.length && std::memcmp(begin, bom.bytes, bom.length) == 0)
+        {
+            bom_length = bom.length;
+            return bom.encoding;
+        }
+    }
+    bom_length = 0;
+
+    std::size_t zeros[4] = {};
+    const std::size_t quads = size / 4;
+    for(std::size_t i = 0; i < quads * 4; i++)
+    {
+        if(!p[i])
+            zeros[i % 4]++;
+    }
+    if(!quads)
+        return text_encoding::utf8;
+    // The highest byte of UTF-32 is always zero, the second highest is for all BMP code points
+    if(zeros[3] == quads && zeros[2] * 2 > quads)
+        return text_encoding::utf32le;
+    if(zeros[0] == quads && zeros[1] * 2 > quads)
+        return text_encoding::utf32be;
+    // The high byte of UTF-16 is zero for ASCII
+    const std::size_t odd_zeros = zeros[1] + zeros[3];
+    const std::size_t even_zeros = zeros[0] + zeros[2];
+    const std::size_t units = quads * 2;
+    if(odd_zeros * 4 >= units && odd_zeros > even_zeros * 2)
+        return text_encoding::utf16le;
+    if(even_zeros * 4 >= units && even_zeros > odd_zeros * 2)
+        return text_encoding::utf16be;
+    return text_encoding::utf8;
+}
+
+///
+/// \brief Stream buffer decoding UTF-8, UTF-16 or UTF-32 text of any byte order from a stream buffer of bytes to UTF-8
+///
+/// The encoding is detected from the start of the input, see detect_encoding(). A byte order mark is skipped.
+/// Input is converted in blocks of \a block_size bytes, bytes are swapped during the conversion
+/// if needed, see utf::endian_unit.
+///
+/// If crlf() is enabled, CR LF line endings are read as LF in the same pass.
+///
+/// Invalid sequences are replaced by #NOWIDE_REPLACEMENT_CHARACTER. Seeking is not supported.
+/// The wrapped stream buffer is not owned.
+///
+class auto_decoding_streambuf : public std::streambuf
+{
+public:
+    /// Smallest supported block size, smaller values are rounded up
+    static constexpr std::size_t min_block_size = 16;
+
+    /// Create a stream buffer decoding the text read from \a bytebuf in blocks of \a block_size bytes
+    explicit auto_decoding_streambuf(std::streambuf* bytebuf = nullptr, std::size_t block_size = 4096) :
+        rdbuf_(bytebuf), block_size_((std::max(block_size, min_block_size) + 3) / 4 * 4)
+    {}
+    auto_decoding_streambuf(const auto_decoding_streambuf&) = delete;
+    auto_decoding_streambuf& operator=(const auto_decoding_streambuf&) = delete;
+
+    /// Return the wrapped stream buffer
+    std::streambuf* rdbuf() const noexcept
+    {
+        return rdbuf_;
+    }
+    ///
+    /// Decode \a bytebuf instead of the current stream buffer and return the previous one
+    ///
+    /// All buffered input is discarded and the encoding is detected again.
+    ///
+    std::streambuf* rdbuf(std::streambuf* bytebuf) noexcept
+    {
+        std::streambuf* const result = rdbuf_;
+        rdbuf_ = bytebuf;
+        detected_ = false;
+        in_size_ = 0;
+        setg(nullptr, nullptr, nullptr);
+        return result;
+    }
+    /// Return the number of bytes decoded at once
+    std::size_t block_size() const noexcept
+    {
+        return block_size_;
+    }
+    /// Return true if CR LF line endings are read as LF, the default is false
+    bool crlf() const noexcept
+    {
+        return crlf_;
+    }
+    /// Enable or disable reading CR LF line endings as LF
+    void crlf(bool enable) noexcept
+    {
+        crlf_ = enable;
+    }
+    ///
+    /// Return the encoding of the input
+    ///
+    /// Reads the start of the input to detect it, if no input was read yet.
+    ///
+    text_encoding encoding()
+    {
+        if(!detected_ && rdbuf_)
+            detect();
+        return encoding_;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if(gptr() != egptr())
+            return traits_type::to_int_type(*gptr());
+        if(!rdbuf_)
+            return traits_type::eof();
+        if(!detected_)
+            detect();
+        for(;;)
+        {
+            bool at_eof = false;
+            if(in_size_ < block_size_)
+            {
+                const std::streamsize count = rdbuf_->sgetn(in_bytes() + in_size_,
+                                                            static_cast<std::streamsize>(block_size_ - in_size_));
+                if(count > 0)
+                    in_size_ += static_cast<std::size_t>(count);
+                else
+                    at_eof = true;
+            }
+            if(!in_size_)
+                return traits_type::eof();
+            char* to = out_.get();
+            std::size_t consumed = 0;
+            switch(encoding_)
+            {
+            case text_encoding::utf8: consumed = decode<char>(to, at_eof); break;
+            case text_encoding::utf16le: consumed = decode<utf::le16>(to, at_eof); break;
+            case text_encoding::utf16be: consumed = decode<utf::be16>(to, at_eof); break;
+            case text_encoding::utf32le: consumed = decode<utf::le32>(to, at_eof); break;
+            case text_encoding::utf32be: consumed = decode<utf::be32>(to, at_eof); break;
+            }
+            // Keep the rest for the next block
+            in_size_ -= consumed;
+            std::memmove(in_bytes(), in_bytes() + consumed, in_size_);
+            if(to != out_.get())
+            {
+                setg(out_.get(), out_.get(), to);
+                return traits_type::to_int_type(*gptr());
+            }
+        }
+    }
+
+private:
+    char* in_bytes() noexcept
+    {
+        return reinterpret_cast<char*>(in_.get());
+    }
+
+    /// Read the first block, detect its encoding and skip the BOM
+    void detect()
+    {
+        if(!in_)
+        {
+            in_.reset(new unsigned char[block_size_]);
+            out_.reset(new char[block_size_]);
+        }
+        const std::streamsize count = rdbuf_->sgetn(in_bytes(), static_cast<std::streamsize>(block_size_));
+        in_size_ = static_cast<std::size_t>(std::max<std::streamsize>(count, 0));
+        std::size_t bom_length;
+        encoding_ = detect_encoding(in_bytes(), in_bytes() + in_size_, bom_length);
+        in_size_ -= bom_length;
+        std::memmove(in_bytes(), in_bytes() + bom_length, in_size_);
+        detected_ = true;
+    }
+
+    /// Convert the input buffer of code units \tparam CharIn to UTF-8 starting at \a to
+    /// \return the number of bytes consumed
+    template<typename CharIn>
+    std::size_t decode(char*& to, bool at_eof)
+    {
+        const CharIn* const begin = reinterpret_cast<const CharIn*>(in_.get());
+        const std::size_t unit_count = in_size_ / sizeof(CharIn);
+        const utf::newline_conversion newlines =
+          crlf_ ? utf::newline_conversion::crlf_to_lf : utf::newline_conversion::none;
+        const CharIn* const end =
+          at_eof ? begin + unit_count : utf::complete_sequences_end(begin, begin + unit_count, newlines);
+        const CharIn* from = begin;
+        char* const to_end = out_.get() + block_size_;
+        utf::convert_prefix(to, to_end, from, end, newlines);
+        std::size_t consumed = (from - begin) * sizeof(CharIn);
+        // Trailing bytes not forming a code unit at the end of the input
+        if(at_eof && from == end && consumed != in_size_
+           && to_end - to >= utf::utf_traits<char>::width(NOWIDE_REPLACEMENT_CHARACTER))
+        {
+            to = utf::utf_traits<char>::encode(NOWIDE_REPLACEMENT_CHARACTER, to);
+            consumed = in_size_;
+        }
+        return consumed;
+    }
+
+    std::streambuf* rdbuf_;
+    std::size_t block_size_;
+    bool crlf_{false};
+    bool detected_{false};
+    text_encoding encoding_{text_encoding::utf8};
+    std::unique_ptr<unsigned char[]> in_;
+    std::size_t in_size_{0};
+    std::unique_ptr<char[]> out_;
+}; // auto_decoding_streambuf
+
+///
+/// \brief Input file stream reading UTF-8, UTF-16 or UTF-32 text of any byte order as UTF-8
+///
+/// The file is opened in binary mode and decoded by an auto_decoding_streambuf, the detected encoding
+/// is returned by encoding(). File names are UTF-8 like for nowide::ifstream.
+///
+class auto_ifstream : public std::istream
+{
+public:
+    auto_ifstream() : std::istream(&decoder_), decoder_(&file_)
+    {}
+    explicit auto_ifstream(const char* file_name) : auto_ifstream()
+    {
+        open(file_name);
+    }
+    explicit auto_ifstream(const std::string& file_name) : auto_ifstream()
+    {
+        open(file_name);
+    }
+    auto_ifstream(const auto_ifstream&) = delete;
+    auto_ifstream& operator=(const auto_ifstream&) = delete;
+
+    void open(const std::string& file_name)
+    {
+        open(file_name.c_str());
+    }
+    void open(const char* file_name)
+    {
+        if(!file_.open(file_name, std::ios_base::in | std::ios_base::binary))
+            setstate(std::ios_base::failbit);
+        else
+        {
+            decoder_.rdbuf(&file_);
+            clear();
+        }
+    }
+    bool is_open() const
+    {
+        return file_.is_open();
+    }
+    void close()
+    {
+        if(!file_.close())
+            setstate(std::ios_base::failbit);
+        decoder_.rdbuf(&file_);
+    }
+    /// Return the encoding of the file, see auto_decoding_streambuf::encoding()
+    text_encoding encoding()
+    {
+        return decoder_.encoding();
+    }
+    auto_decoding_streambuf* rdbuf() const
+    {
+        return const_cast<auto_decoding_streambuf*>(&decoder_);
+    }
+
+private:
+    filebuf file_;
+    auto_decoding_streambuf decoder_;
+}; // auto_ifstream
+
+} // namespace nowide
+
+#endif
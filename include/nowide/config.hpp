@@ -82,6 +82,10 @@
 #define NOWIDE_ELSE(x) else x
 #endif // !NOWIDE_ELSE
 
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define NOWIDE_BIG_ENDIAN
+#endif
+
 #if defined(NOWIDE_MSVC) || defined(NOWIDE_GCC) || defined(NOWIDE_CLANG)
 #define NOWIDE_RESTRICT __restrict
 #else
@@ -0,0 +1,174 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_CONVERSION_CACHE_HPP_INCLUDED
+#define NOWIDE_CONVERSION_CACHE_HPP_INCLUDED
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <nowide/convert.hpp>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace nowide {
+///
+/// \brief A bounded, thread safe LRU cache of converted strings
+///
+/// Frequently converted strings like file paths are converted once and then served from the cache.
+/// The cache is split into shards, each guarded by its own mutex and holding its own LRU list,
+/// so concurrent lookups of different strings rarely contend.
+///
+/// Results are shared and immutable, so they remain valid after being evicted from the cache.
+///
+/// Invalid UTF characters are replaced by the substitution character, see #NOWIDE_REPLACEMENT_CHARACTER
+///
+template<typename CharOut = wchar_t, typename CharIn = char>
+class conversion_cache
+{
+public:
+    /// Type of the output character (converted to)
+    using output_char = CharOut;
+    /// Type of the input character (converted from)
+    using input_char = CharIn;
+    /// Type of the converted strings
+    using string_type = std::basic_string<output_char>;
+    /// Shared handle to a converted string
+    using value_type = std::shared_ptr<const string_type>;
+
+    /// Create a cache holding at most \a capacity strings split into \a shard_count shards
+    explicit conversion_cache(std::size_t capacity = 4096, std::size_t shard_count = 16) :
+        shard_count_(shard_count ? shard_count : 1),
+        shard_capacity_((capacity + shard_count_ - 1) / shard_count_), shards_(new shard[shard_count_])
+    {
+        if(!shard_capacity_)
+            shard_capacity_ = 1;
+    }
+
+    conversion_cache(const conversion_cache&) = delete;
+    conversion_cache& operator=(const conversion_cache&) = delete;
+
+    /// Return the converted \a input, converting and caching it if it is not cached yet
+    value_type get(std::basic_string_view<input_char> input)
+    {
+        const std::size_t hash = std::hash<std::basic_string_view<input_char>>()(input);
+        shard& s = shards_[hash % shard_count_];
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            const auto it = s.index.find(input);
+            if(it != s.index.end())
+            {
+                s.hits.fetch_add(1, std::memory_order_relaxed);
+                s.lru.splice(s.lru.begin(), s.lru, it->second);
+                return it->second->value;
+            }
+            s.misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Convert outside of the lock so other lookups in this shard are not blocked
+        value_type value = std::make_shared<const string_type>(
+          utf::convert_string<output_char>(input.data(), input.data() + input.size()));
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        const auto it = s.index.find(input);
+        if(it != s.index.end())
+        {
+            // Another thread inserted it meanwhile
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            return it->second->value;
+        }
+        if(s.lru.size() >= shard_capacity_)
+        {
+            s.index.erase(s.lru.back().key);
+            s.lru.pop_back();
+        }
+        s.lru.push_front(entry{std::basic_string<input_char>(input), value});
+        // The key view refers to the string in the list node which does not move
+        s.index.emplace(s.lru.front().key, s.lru.begin());
+        return value;
+    }
+    /// Return the converted NULL terminated \a input, see get(std::basic_string_view<input_char>)
+    value_type get(const input_char* input)
+    {
+        return get(std::basic_string_view<input_char>(input));
+    }
+
+    /// Remove all strings from the cache, keeps the statistics
+    void clear()
+    {
+        for(std::size_t i = 0; i < shard_count_; i++)
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            shards_[i].index.clear();
+            shards_[i].lru.clear();
+        }
+    }
+
+    /// Return the number of currently cached strings
+    std::size_t size() const
+    {
+        std::size_t result = 0;
+        for(std::size_t i = 0; i < shard_count_; i++)
+        {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            result += shards_[i].lru.size();
+        }
+        return result;
+    }
+    /// Return the maximum number of cached strings
+    std::size_t capacity() const noexcept
+    {
+        return shard_capacity_ * shard_count_;
+    }
+    /// Return the number of lookups served from the cache
+    std::size_t hits() const noexcept
+    {
+        std::size_t result = 0;
+        for(std::size_t i = 0; i < shard_count_; i++)
+            result += shards_[i].hits.load(std::memory_order_relaxed);
+        return result;
+    }
+    /// Return the number of lookups which required a conversion
+    std::size_t misses() const noexcept
+    {
+        std::size_t result = 0;
+        for(std::size_t i = 0; i < shard_count_; i++)
+            result += shards_[i].misses.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    struct entry
+    {
+        std::basic_string<input_char> key;
+        value_type value;
+    };
+    // Separate cache lines avoid false sharing between shards
+    struct alignas(64) shard
+    {
+        mutable std::mutex mutex;
+        std::list<entry> lru;
+        std::unordered_map<std::basic_string_view<input_char>, typename std::list<entry>::iterator> index;
+        std::atomic<std::size_t> hits{0};
+        std::atomic<std::size_t> misses{0};
+    };
+
+    std::size_t shard_count_;
+    std::size_t shard_capacity_;
+    std::unique_ptr<shard[]> shards_;
+}; // conversion_cache
+
+///
+/// Convenience typedef
+///
+using wconversion_cache = conversion_cache<wchar_t, char>;
+
+} // namespace nowide
+
+#endif
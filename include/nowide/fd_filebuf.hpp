@@ -0,0 +1,1150 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_FD_FILEBUF_HPP_INCLUDED
+#define NOWIDE_FD_FILEBUF_HPP_INCLUDED
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <nowide/config.hpp>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#ifdef NOWIDE_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#include <nowide/stackstring.hpp>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace nowide {
+///
+/// \brief Expected access pattern of a file, see fd_filebuf::advise()
+///
+enum class file_advice
+{
+    normal,
+    sequential,
+    random,
+    /// Read the range into the page cache now
+    will_need,
+    /// Drop the range from the page cache
+    dont_need
+};
+
+/// \cond INTERNAL
+namespace detail {
+#ifdef NOWIDE_WINDOWS
+    using fd_offset = __int64;
+
+    inline int fd_open(const wchar_t* name, int flags) noexcept
+    {
+        return ::_wopen(name, flags | _O_BINARY | _O_NOINHERIT, _S_IREAD | _S_IWRITE);
+    }
+    inline std::ptrdiff_t fd_read(int fd, void* buffer, std::size_t size) noexcept
+    {
+        return ::_read(fd, buffer, static_cast<unsigned>(std::min<std::size_t>(size, INT_MAX)));
+    }
+    inline std::ptrdiff_t fd_write(int fd, const void* buffer, std::size_t size) noexcept
+    {
+        return ::_write(fd, buffer, static_cast<unsigned>(std::min<std::size_t>(size, INT_MAX)));
+    }
+    /// Write two buffers in order with one call, return the number of bytes written or -1 on error
+    inline std::ptrdiff_t
+    fd_write2(int fd, const char* first, std::size_t first_size, const char* second, std::size_t second_size) noexcept
+    {
+        // No gathering write, a partial write of the first non-empty buffer is allowed
+        return first_size ? fd_write(fd, first, first_size) : fd_write(fd, second, second_size);
+    }
+    inline fd_offset fd_seek(int fd, fd_offset offset, int whence) noexcept
+    {
+        return ::_lseeki64(fd, offset, whence);
+    }
+    inline int fd_close(int fd) noexcept
+    {
+        return ::_close(fd);
+    }
+    constexpr int fd_rdonly = _O_RDONLY, fd_wronly = _O_WRONLY, fd_rdwr = _O_RDWR;
+    constexpr int fd_creat = _O_CREAT, fd_trunc = _O_TRUNC, fd_append = _O_APPEND, fd_excl = _O_EXCL;
+    // No direct I/O through the CRT
+    constexpr int fd_direct = 0;
+    inline bool fd_set_direct(int, bool) noexcept
+    {
+        return false;
+    }
+    inline bool fd_advise(int, fd_offset, fd_offset, file_advice) noexcept
+    {
+        return false;
+    }
+    inline void fd_writeback(int, fd_offset, fd_offset, bool) noexcept
+    {}
+    inline bool fd_allocate(int, fd_offset, fd_offset) noexcept
+    {
+        return false;
+    }
+    inline bool fd_punch_hole(int, fd_offset, fd_offset) noexcept
+    {
+        return false;
+    }
+#else
+    using fd_offset = off_t;
+
+    inline int fd_open(const char* name, int flags) noexcept
+    {
+        int fd;
+        do
+            fd = ::open(name, flags | O_CLOEXEC, 0666);
+        while(fd < 0 && errno == EINTR);
+        return fd;
+    }
+    inline std::ptrdiff_t fd_read(int fd, void* buffer, std::size_t size) noexcept
+    {
+        ssize_t result;
+        do
+            result = ::read(fd, buffer, std::min<std::size_t>(size, SSIZE_MAX));
+        while(result < 0 && errno == EINTR);
+        return result;
+    }
+    inline std::ptrdiff_t fd_write(int fd, const void* buffer, std::size_t size) noexcept
+    {
+        ssize_t result;
+        do
+            result = ::write(fd, buffer, std::min<std::size_t>(size, SSIZE_MAX));
+        while(result < 0 && errno == EINTR);
+        return result;
+    }
+    /// Write two buffers in order with one call, return the number of bytes written or -1 on error
+    inline std::ptrdiff_t
+    fd_write2(int fd, const char* first, std::size_t first_size, const char* second, std::size_t second_size) noexcept
+    {
+        first_size = std::min<std::size_t>(first_size, SSIZE_MAX);
+        second_size = std::min<std::size_t>(second_size, SSIZE_MAX - first_size);
+        iovec buffers[2] = {{const_cast<char*>(first), first_size}, {const_cast<char*>(second), second_size}};
+        const int skip = first_size ? 0 : 1;
+        ssize_t result;
+        do
+            result = ::writev(fd, buffers + skip, 2 - skip);
+        while(result < 0 && errno == EINTR);
+        return result;
+    }
+    inline fd_offset fd_seek(int fd, fd_offset offset, int whence) noexcept
+    {
+        return ::lseek(fd, offset, whence);
+    }
+    inline int fd_close(int fd) noexcept
+    {
+        return ::close(fd);
+    }
+    constexpr int fd_rdonly = O_RDONLY, fd_wronly = O_WRONLY, fd_rdwr = O_RDWR;
+    constexpr int fd_creat = O_CREAT, fd_trunc = O_TRUNC, fd_append = O_APPEND, fd_excl = O_EXCL;
+#ifdef O_DIRECT
+    constexpr int fd_direct = O_DIRECT;
+    /// Enable or disable direct I/O on an open file, return false on error
+    inline bool fd_set_direct(int fd, bool enable) noexcept
+    {
+        const int flags = ::fcntl(fd, F_GETFL);
+        return flags >= 0 && ::fcntl(fd, F_SETFL, enable ? flags | O_DIRECT : flags & ~O_DIRECT) == 0;
+    }
+#else
+    constexpr int fd_direct = 0;
+    inline bool fd_set_direct(int, bool) noexcept
+    {
+        return false;
+    }
+#endif
+    /// Give the access hint \a advice for a range of the file, to its end if \a length is 0
+    inline bool fd_advise(int fd, fd_offset offset, fd_offset length, file_advice advice) noexcept
+    {
+#ifdef POSIX_FADV_NORMAL
+        // On Linux POSIX_FADV_WILLNEED starts readahead of the range
+        const int values[] = {
+          POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED, POSIX_FADV_DONTNEED};
+        return ::posix_fadvise(fd, offset, length, values[static_cast<int>(advice)]) == 0;
+#else
+        (void)fd, (void)offset, (void)length, (void)advice;
+        return false;
+#endif
+    }
+    /// Start writing back dirty pages of a range and optionally wait for it, if supported
+    inline void fd_writeback(int fd, fd_offset offset, fd_offset length, bool wait) noexcept
+    {
+#ifdef SYNC_FILE_RANGE_WRITE
+        const unsigned flags = wait ? SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER
+                                    : SYNC_FILE_RANGE_WRITE;
+        ::sync_file_range(fd, offset, length, flags);
+#else
+        (void)fd, (void)offset, (void)length, (void)wait;
+#endif
+    }
+#ifdef FALLOC_FL_KEEP_SIZE
+    inline bool fd_fallocate(int fd, int mode, fd_offset offset, fd_offset length) noexcept
+    {
+        int result;
+        do
+            result = ::fallocate(fd, mode, offset, length);
+        while(result < 0 && errno == EINTR);
+        return result == 0;
+    }
+    /// Allocate disk space for a range of the file without changing its size
+    inline bool fd_allocate(int fd, fd_offset offset, fd_offset length) noexcept
+    {
+        return fd_fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, length);
+    }
+    /// Deallocate a range of the file, which then reads as zeros, without changing its size
+    inline bool fd_punch_hole(int fd, fd_offset offset, fd_offset length) noexcept
+    {
+        return fd_fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length);
+    }
+#else
+    inline bool fd_allocate(int, fd_offset, fd_offset) noexcept
+    {
+        return false;
+    }
+    inline bool fd_punch_hole(int, fd_offset, fd_offset) noexcept
+    {
+        return false;
+    }
+#endif
+#endif
+
+    /// Flags for opening a file with \a mode like std::basic_filebuf or -1 if the combination is invalid
+    inline int fd_open_flags(std::ios_base::openmode mode) noexcept
+    {
+        using std::ios_base;
+        // Same combinations as the fopen modes used by std::basic_filebuf
+        struct mode_flags
+        {
+            std::ios_base::openmode mode;
+            int flags;
+        };
+        const mode_flags table[] = {
+          {ios_base::out, fd_wronly | fd_creat | fd_trunc},
+          {ios_base::out | ios_base::trunc, fd_wronly | fd_creat | fd_trunc},
+          {ios_base::app, fd_wronly | fd_creat | fd_append},
+          {ios_base::out | ios_base::app, fd_wronly | fd_creat | fd_append},
+          {ios_base::in, fd_rdonly},
+          {ios_base::in | ios_base::out, fd_rdwr},
+          {ios_base::in | ios_base::out | ios_base::trunc, fd_rdwr | fd_creat | fd_trunc},
+          {ios_base::in | ios_base::app, fd_rdwr | fd_creat | fd_append},
+          {ios_base::in | ios_base::out | ios_base::app, fd_rdwr | fd_creat | fd_append}};
+        mode &= ~(ios_base::ate | ios_base::binary);
+        for(const mode_flags& entry : table)
+        {
+            if(entry.mode == mode)
+                return entry.flags;
+        }
+        return -1;
+    }
+} // namespace detail
+/// \endcond
+
+///
+/// \brief Options for opening a file with fd_filebuf in addition to the std::ios_base::openmode
+///
+enum class file_options : unsigned
+{
+    none = 0,
+    /// Bypass the page cache, e.g. O_DIRECT on Linux, see fd_filebuf::is_direct_io()
+    direct_io = 1,
+    /// Drop pages already read or written from the page cache while streaming through the file
+    drop_behind = 2,
+    /// Leave holes instead of writing runs of zeros where supported, see fd_filebuf::punch_hole()
+    sparse = 4
+};
+constexpr file_options operator|(file_options lhs, file_options rhs) noexcept
+{
+    return file_options(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+}
+constexpr file_options operator&(file_options lhs, file_options rhs) noexcept
+{
+    return file_options(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+}
+
+///
+/// \brief File stream buffer of bytes owned by nowide and built directly on the file descriptor API
+///
+/// Unlike std::filebuf it doesn't use a locale, so no codecvt is involved, and its buffer size can be tuned
+/// with buffer_size() or setbuf(). Reads and writes of at least buffer_size() bytes bypass the buffer.
+/// Writes which don't fit into the remaining buffer and are at least a quarter of its size are not copied either,
+/// they are written together with the buffered output in one gathering write (writev). The system calls issued
+/// are counted, see statistics().
+/// Files are opened like with std::filebuf, file names are UTF-8 on all platforms, and the file is always
+/// accessed in binary mode.
+///
+/// With file_options::direct_io the file is read and written with direct I/O bypassing the page cache. The buffer
+/// is then aligned and a multiple of direct_io_alignment bytes, nothing bypasses it, and whole blocks are
+/// transferred directly. Output not starting or ending at a block boundary, e.g. the tail of the file, is written
+/// through the page cache transparently.
+///
+/// With file_options::drop_behind pages behind the current position are dropped from the page cache every
+/// megabyte, so scanning or writing a large file once doesn't evict other cached data. Written pages are dropped
+/// once written back, which is started early for them. Access hints for the whole file or parts of it can be given
+/// with advise().
+///
+/// Disk space for output of known size can be reserved with preallocate(). With file_options::sparse, written
+/// blocks of zeros, at least sparse_block_size bytes aligned to the start of the data written at once, become
+/// holes in the file instead, e.g. with fallocate(FALLOC_FL_PUNCH_HOLE) on Linux. This doesn't apply to files
+/// opened for appending and where holes aren't supported.
+///
+/// Define NOWIDE_USE_FD_FILEBUF to make nowide::filebuf and the char file streams use it.
+///
+class fd_filebuf : public std::streambuf
+{
+public:
+    /// Buffer size used unless changed by buffer_size() or setbuf()
+    static constexpr std::size_t default_buffer_size = 64 * 1024;
+    /// Alignment of the buffer, the file offsets and the sizes used for direct I/O
+    static constexpr std::size_t direct_io_alignment = 4096;
+    /// Size of the blocks of zeros left as holes with file_options::sparse
+    static constexpr std::size_t sparse_block_size = 16 * 1024;
+
+    /// Counters of the system calls issued on the file and the bytes transferred by them
+    struct io_statistics
+    {
+        std::uint64_t read_calls = 0;
+        /// Plain and gathering writes
+        std::uint64_t write_calls = 0;
+        std::uint64_t seek_calls = 0;
+        std::uint64_t bytes_read = 0;
+        std::uint64_t bytes_written = 0;
+        /// Bytes read into or written from the caller's memory directly, without a copy through the buffer
+        std::uint64_t bytes_bypassed = 0;
+    };
+
+    fd_filebuf() = default;
+    fd_filebuf(const fd_filebuf&) = delete;
+    fd_filebuf& operator=(const fd_filebuf&) = delete;
+    fd_filebuf(fd_filebuf&& other) noexcept
+    {
+        swap(other);
+    }
+    /// Close the current file and take over the file of \a rhs
+    fd_filebuf& operator=(fd_filebuf&& rhs)
+    {
+        close();
+        swap(rhs);
+        return *this;
+    }
+    ~fd_filebuf() override
+    {
+        close();
+    }
+    void swap(fd_filebuf& other) noexcept
+    {
+        // The buffers are heap allocated or owned by the caller, so the get and put areas stay valid
+        std::streambuf::swap(other);
+        std::swap(fd_, other.fd_);
+        std::swap(mode_, other.mode_);
+        std::swap(buffer_size_, other.buffer_size_);
+        std::swap(buffer_, other.buffer_);
+        owned_buffer_.swap(other.owned_buffer_);
+        std::swap(stats_, other.stats_);
+        std::swap(direct_, other.direct_);
+        std::swap(sparse_, other.sparse_);
+        std::swap(hole_at_end_, other.hole_at_end_);
+        std::swap(drop_behind_, other.drop_behind_);
+        std::swap(position_, other.position_);
+        std::swap(drop_from_, other.drop_from_);
+        std::swap(drop_done_, other.drop_done_);
+        std::swap(drop_pending_, other.drop_pending_);
+    }
+
+    ///
+    /// Open the file \a file_name with \a mode like std::filebuf::open
+    ///
+    /// If \a options request direct I/O but the platform or file system doesn't support it the file is accessed
+    /// through the page cache, see is_direct_io().
+    ///
+    /// \return this on success, NULL if the file couldn't be opened, the mode is invalid or a file is already open
+    ///
+    fd_filebuf* open(const char* file_name, std::ios_base::openmode mode, file_options options = file_options::none)
+    {
+#ifdef NOWIDE_WINDOWS
+        const wstackstring name(file_name);
+        return open_native(name.data(), mode, options);
+#else
+        return open_native(file_name, mode, options);
+#endif
+    }
+    fd_filebuf*
+    open(const std::string& file_name, std::ios_base::openmode mode, file_options options = file_options::none)
+    {
+        return open(file_name.c_str(), mode, options);
+    }
+#ifdef NOWIDE_WINDOWS
+    fd_filebuf* open(const wchar_t* file_name, std::ios_base::openmode mode, file_options options = file_options::none)
+    {
+        return open_native(file_name, mode, options);
+    }
+#endif
+    bool is_open() const noexcept
+    {
+        return fd_ >= 0;
+    }
+    /// Return true if the open file is accessed with direct I/O
+    bool is_direct_io() const noexcept
+    {
+        return direct_;
+    }
+    ///
+    /// Tell the system how [\a offset, \a offset + \a length) of the file, or all of it from \a offset if \a length
+    /// is 0, will be accessed, e.g. with posix_fadvise
+    ///
+    /// \return true on success, false if no file is open or the hint isn't supported
+    ///
+    bool advise(file_advice advice, std::uint64_t offset = 0, std::uint64_t length = 0) noexcept
+    {
+        return is_open()
+               && detail::fd_advise(fd_, detail::fd_offset(offset), detail::fd_offset(length), advice);
+    }
+    ///
+    /// Reserve disk space for the first \a size bytes of the file without changing its size, so writing up to
+    /// \a size bytes doesn't fragment the file or update its allocation each time, e.g. fallocate on Linux
+    ///
+    /// \return true on success, false if no file is open, allocating failed or isn't supported
+    ///
+    bool preallocate(std::uint64_t size) noexcept
+    {
+        return is_open() && (!size || detail::fd_allocate(fd_, 0, detail::fd_offset(size)));
+    }
+    ///
+    /// Deallocate [\a offset, \a offset + \a length) of the file, which then reads as zeros, without changing its
+    /// size. Buffered output is written first and the file position is moved back over unread input.
+    ///
+    /// \return true on success, false if no file is open for writing, deallocating failed or isn't supported
+    ///
+    bool punch_hole(std::uint64_t offset, std::uint64_t length)
+    {
+        if(!is_open() || !(mode_ & (std::ios_base::out | std::ios_base::app)) || !reset_buffer())
+            return false;
+        return !length || detail::fd_punch_hole(fd_, detail::fd_offset(offset), detail::fd_offset(length));
+    }
+    ///
+    /// Write buffered output and close the file
+    ///
+    /// \return this on success, NULL if no file was open or writing or closing failed
+    ///
+    fd_filebuf* close()
+    {
+        if(!is_open())
+            return nullptr;
+        const bool flushed = reset_buffer();
+        const bool closed = detail::fd_close(fd_) == 0;
+        fd_ = -1;
+        direct_ = false;
+        return flushed && closed ? this : nullptr;
+    }
+    /// Return the file descriptor or -1 if no file is open
+    int fd() const noexcept
+    {
+        return fd_;
+    }
+    /// Return the size of the buffer
+    std::size_t buffer_size() const noexcept
+    {
+        return buffer_size_;
+    }
+    ///
+    /// Use an internal buffer of \a size bytes, at least 1 or rounded up to a multiple of direct_io_alignment
+    /// with direct I/O
+    ///
+    /// Buffered output is written first and the file position is moved back over unread input.
+    ///
+    void buffer_size(std::size_t size)
+    {
+        reset_buffer();
+        buffer_ = nullptr;
+        owned_buffer_.reset();
+        buffer_size_ = direct_ ? direct_buffer_size(size) : std::max<std::size_t>(size, 1);
+    }
+    /// Return the counters accumulated since construction or the last call to reset_statistics()
+    const io_statistics& statistics() const noexcept
+    {
+        return stats_;
+    }
+    void reset_statistics() noexcept
+    {
+        stats_ = io_statistics();
+    }
+
+protected:
+    ///
+    /// Use [\a s, \a s + \a n) as the buffer, or an internal buffer of 1 byte if \a s is NULL or \a n is 0
+    ///
+    /// With direct I/O \a s is only used if it is aligned and \a n a multiple of direct_io_alignment, otherwise
+    /// an internal buffer of at least \a n bytes is used.
+    ///
+    std::streambuf* setbuf(char* s, std::streamsize n) override
+    {
+        if(!s || n <= 0)
+            buffer_size(1);
+        else
+        {
+            buffer_size(static_cast<std::size_t>(n));
+            if(buffer_size_ == static_cast<std::size_t>(n) && (!direct_ || is_direct_aligned(s)))
+                buffer_ = s;
+        }
+        return this;
+    }
+
+    int sync() override
+    {
+        return flush_output() && end_hole() ? 0 : -1;
+    }
+
+    int_type underflow() override
+    {
+        if(gptr() != egptr())
+            return traits_type::to_int_type(*gptr());
+        if(!is_open() || !(mode_ & std::ios_base::in))
+            return traits_type::eof();
+        // Switch from writing
+        if(pbase() && !reset_buffer())
+            return traits_type::eof();
+        char* const buffer = get_buffer();
+        detail::fd_offset position = 0;
+        std::ptrdiff_t offset = 0;
+        if(direct_)
+        {
+            // Read from the start of the block containing the current position
+            position = seek(0, SEEK_CUR);
+            if(position < 0)
+                return traits_type::eof();
+            offset = static_cast<std::ptrdiff_t>(position % detail::fd_offset(direct_io_alignment));
+            if(offset && seek(-detail::fd_offset(offset), SEEK_CUR) < 0)
+                return traits_type::eof();
+        }
+        const std::ptrdiff_t count = read_some(buffer, buffer_size_);
+        if(count <= offset)
+        {
+            if(offset && count != offset)
+                seek(position, SEEK_SET);
+            setg(nullptr, nullptr, nullptr);
+            return traits_type::eof();
+        }
+        setg(buffer, buffer + offset, buffer + count);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if(!is_open() || !(mode_ & (std::ios_base::out | std::ios_base::app)))
+            return traits_type::eof();
+        if(!pbase())
+        {
+            // Switch from reading, continue at the current position
+            if(!reset_buffer())
+                return traits_type::eof();
+            char* const buffer = get_buffer();
+            std::size_t offset = 0;
+            if(direct_)
+            {
+                // Keep the data at the same offset from the buffer as the position from the block start
+                const detail::fd_offset position = seek(0, (mode_ & std::ios_base::app) ? SEEK_END : SEEK_CUR);
+                if(position < 0)
+                    return traits_type::eof();
+                offset = static_cast<std::size_t>(position % detail::fd_offset(direct_io_alignment));
+            }
+            setp(buffer + offset, buffer + buffer_size_);
+        } else if(!flush_output())
+            return traits_type::eof();
+        if(traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+        return c;
+    }
+
+    int_type pbackfail(int_type c) override
+    {
+        if(!is_open() || !(mode_ & std::ios_base::in) || pbase())
+            return traits_type::eof();
+        if(gptr() == eback())
+        {
+            // At the start of the buffer, go back in the file
+            if(seekoff(-1, std::ios_base::cur, std::ios_base::in) == pos_type(off_type(-1)))
+                return traits_type::eof();
+            if(traits_type::eq_int_type(underflow(), traits_type::eof()))
+                return traits_type::eof();
+        } else
+            gbump(-1);
+        if(traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::to_int_type(*gptr());
+        *gptr() = traits_type::to_char_type(c);
+        return c;
+    }
+
+    std::streamsize xsgetn(char* s, std::streamsize n) override
+    {
+        std::streamsize result = 0;
+        while(result < n)
+        {
+            const std::streamsize available = egptr() - gptr();
+            if(available)
+            {
+                const std::streamsize count = std::min(available, n - result);
+                std::memcpy(s + result, gptr(), static_cast<std::size_t>(count));
+                gbump_n(count);
+                result += count;
+            } else if(!direct_ && static_cast<std::size_t>(n - result) >= buffer_size_ && is_open()
+                      && (mode_ & std::ios_base::in))
+            {
+                // Read directly into the destination
+                if(pbase() && !reset_buffer())
+                    break;
+                setg(nullptr, nullptr, nullptr);
+                const std::ptrdiff_t count = read_some(s + result, static_cast<std::size_t>(n - result));
+                if(count <= 0)
+                    break;
+                stats_.bytes_bypassed += static_cast<std::uint64_t>(count);
+                result += count;
+            } else if(traits_type::eq_int_type(underflow(), traits_type::eof()))
+                break;
+        }
+        return result;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        if(n <= 0)
+            return 0;
+        if(n <= epptr() - pptr())
+        {
+            std::memcpy(pptr(), s, static_cast<std::size_t>(n));
+            pbump_n(n);
+            return n;
+        }
+        // Copy small data only, the buffer must be written anyway and can take the rest in the same call
+        const std::size_t size = static_cast<std::size_t>(n);
+        if(direct_ || (size < buffer_size_ && (!pbase() || size < buffer_size_ / 4)))
+            return std::streambuf::xsputn(s, n);
+        if(!is_open() || !(mode_ & (std::ios_base::out | std::ios_base::app)))
+            return 0;
+        if(!pbase() && !reset_buffer())
+            return 0;
+        const char* const pending = pbase();
+        const std::size_t pending_size = static_cast<std::size_t>(pptr() - pbase());
+        setp(pbase(), epptr());
+        if(!write_all(pending, pending_size, s, size))
+            return 0;
+        stats_.bytes_bypassed += size;
+        return n;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode /*which*/) override
+    {
+        if(!is_open())
+            return pos_type(off_type(-1));
+        const detail::fd_offset position = seek(0, SEEK_CUR);
+        if(position < 0)
+            return pos_type(off_type(-1));
+        const off_type current = off_type(position) - (egptr() - gptr()) + (pptr() - pbase());
+        if(dir == std::ios_base::cur && off == 0)
+            return pos_type(current);
+        if(dir != std::ios_base::end && gptr())
+        {
+            // Move within the get area if possible
+            const off_type target = dir == std::ios_base::beg ? off : current + off;
+            const off_type buffer_start = off_type(position) - (egptr() - eback());
+            if(target >= buffer_start && target <= off_type(position))
+            {
+                setg(eback(), eback() + (target - buffer_start), egptr());
+                return pos_type(target);
+            }
+        }
+        if(!reset_buffer())
+            return pos_type(off_type(-1));
+        const int whence = dir == std::ios_base::beg ? SEEK_SET : dir == std::ios_base::cur ? SEEK_CUR : SEEK_END;
+        const detail::fd_offset result = seek(detail::fd_offset(off), whence);
+        return pos_type(off_type(result < 0 ? -1 : result));
+    }
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+private:
+    template<typename CharType>
+    fd_filebuf* open_native(const CharType* file_name, std::ios_base::openmode mode, file_options options)
+    {
+        if(is_open())
+            return nullptr;
+        const int flags = detail::fd_open_flags(mode);
+        if(flags < 0)
+            return nullptr;
+        bool direct = (options & file_options::direct_io) != file_options::none && detail::fd_direct != 0;
+        int fd = detail::fd_open(file_name, direct ? flags | detail::fd_direct : flags);
+        // File systems without direct I/O, e.g. tmpfs, reject the flag
+        if(fd < 0 && direct && errno == EINVAL)
+        {
+            direct = false;
+            fd = detail::fd_open(file_name, flags);
+        }
+        if(fd < 0)
+            return nullptr;
+        fd_ = fd;
+        mode_ = mode;
+        drop_behind_ = (options & file_options::drop_behind) != file_options::none;
+        drop_from_ = drop_done_ = drop_pending_ = 0;
+        // Appending writes move the position to the end of the file
+        position_ = (mode & std::ios_base::app) ? -1 : 0;
+        // Appended data ignores the file position, so holes can't be skipped
+        sparse_ = (options & file_options::sparse) != file_options::none && !(mode & std::ios_base::app);
+        if(direct)
+        {
+            // Keep a buffer which is usable for direct I/O already
+            direct_ = true;
+            const std::size_t size = direct_buffer_size(buffer_size_);
+            if(size != buffer_size_ || (buffer_ && !is_direct_aligned(buffer_)))
+            {
+                buffer_ = nullptr;
+                owned_buffer_.reset();
+                buffer_size_ = size;
+            }
+        }
+        if(mode & std::ios_base::ate)
+        {
+            const detail::fd_offset end = seek(0, SEEK_END);
+            if(end < 0)
+            {
+                detail::fd_close(fd);
+                fd_ = -1;
+                direct_ = false;
+                return nullptr;
+            }
+            drop_from_ = drop_done_ = drop_pending_ = end;
+        }
+        return this;
+    }
+
+    char* get_buffer()
+    {
+        if(!buffer_)
+        {
+            if(direct_)
+            {
+                owned_buffer_.reset(new char[buffer_size_ + direct_io_alignment - 1]);
+                const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(owned_buffer_.get());
+                const std::size_t padding = (direct_io_alignment - address % direct_io_alignment) % direct_io_alignment;
+                buffer_ = owned_buffer_.get() + padding;
+            } else
+            {
+                owned_buffer_.reset(new char[buffer_size_]);
+                buffer_ = owned_buffer_.get();
+            }
+        }
+        return buffer_;
+    }
+    static std::size_t direct_buffer_size(std::size_t size)
+    {
+        return std::max<std::size_t>((size + direct_io_alignment - 1) / direct_io_alignment, 1) * direct_io_alignment;
+    }
+    static bool is_direct_aligned(const char* buffer)
+    {
+        return reinterpret_cast<std::uintptr_t>(buffer) % direct_io_alignment == 0;
+    }
+
+    void gbump_n(std::streamsize n)
+    {
+        setg(eback(), gptr() + n, egptr());
+    }
+    void pbump_n(std::streamsize n)
+    {
+        // pbump takes an int, which may be too small for large buffers
+        for(; n > INT_MAX; n -= INT_MAX)
+            pbump(INT_MAX);
+        pbump(static_cast<int>(n));
+    }
+
+    std::ptrdiff_t read_some(char* buffer, std::size_t size)
+    {
+        const std::ptrdiff_t count = detail::fd_read(fd_, buffer, size);
+        stats_.read_calls++;
+        if(count > 0)
+        {
+            stats_.bytes_read += static_cast<std::uint64_t>(count);
+            advance_position(count);
+            if(drop_behind_)
+                drop_behind(count, false);
+        }
+        return count;
+    }
+    /// Write all of both buffers in order, return false on error
+    bool write_all(const char* first, std::size_t first_size, const char* second = nullptr, std::size_t second_size = 0)
+    {
+        if(sparse_)
+        {
+            // Write each buffer with holes on its own
+            const bool result = write_sparse(first, first_size) && write_sparse(second, second_size);
+            if(drop_behind_ && (first_size || second_size))
+                drop_behind(0, true);
+            return result;
+        }
+        if(drop_behind_ && (first_size || second_size))
+        {
+            const bool result = write_all_impl(first, first_size, second, second_size);
+            drop_behind(0, true);
+            return result;
+        }
+        return write_all_impl(first, first_size, second, second_size);
+    }
+    ///
+    /// Write \a data leaving holes for blocks of zeros. Skipping a hole at the end of the file doesn't extend it,
+    /// which end_hole() does when needed.
+    ///
+    bool write_sparse(const char* data, std::size_t size)
+    {
+        std::size_t written = 0;
+        std::size_t pos = 0;
+        while(pos < size)
+        {
+            // Find the next run of zero blocks
+            std::size_t run = 0;
+            for(; size - pos - run >= sparse_block_size && is_zero_block(data + pos + run); run += sparse_block_size)
+            {}
+            if(!run)
+            {
+                pos = std::min(pos + sparse_block_size, size);
+                continue;
+            }
+            if(!write_all_impl(data + written, pos - written, nullptr, 0))
+                return false;
+            written = pos;
+            if(!skip_hole(run))
+            {
+                // No holes, write the zeros
+                sparse_ = false;
+                break;
+            }
+            pos += run;
+            written = pos;
+            hole_at_end_ = true;
+        }
+        if(written == size)
+            return true;
+        hole_at_end_ = false;
+        return write_all_impl(data + written, size - written, nullptr, 0);
+    }
+    static bool is_zero_block(const char* block)
+    {
+        return block[0] == 0 && std::memcmp(block, block + 1, sparse_block_size - 1) == 0;
+    }
+    /// Move the file position over \a size bytes which are deallocated, return false if holes aren't supported
+    bool skip_hole(std::size_t size)
+    {
+        const detail::fd_offset end = seek(detail::fd_offset(size), SEEK_CUR);
+        if(end < 0)
+            return false;
+        if(detail::fd_punch_hole(fd_, end - detail::fd_offset(size), detail::fd_offset(size)))
+            return true;
+        seek(-detail::fd_offset(size), SEEK_CUR);
+        return false;
+    }
+    /// Write the last byte of a hole skipped last, so the file is extended over it
+    bool end_hole()
+    {
+        if(!hole_at_end_)
+            return true;
+        hole_at_end_ = false;
+        const char zero = 0;
+        if(seek(-1, SEEK_CUR) < 0)
+            return false;
+        return direct_ ? write_cached(&zero, 1) : write_all_impl(&zero, 1, nullptr, 0);
+    }
+    bool write_all_impl(const char* first, std::size_t first_size, const char* second, std::size_t second_size)
+    {
+        while(first_size || second_size)
+        {
+            const std::ptrdiff_t written = detail::fd_write2(fd_, first, first_size, second, second_size);
+            stats_.write_calls++;
+            if(written <= 0)
+                return false;
+            stats_.bytes_written += static_cast<std::uint64_t>(written);
+            // Appending writes start at the end of the file, which may have been moved by others
+            if(mode_ & std::ios_base::app)
+                position_ = -1;
+            else
+                advance_position(written);
+            std::size_t count = static_cast<std::size_t>(written);
+            const std::size_t from_first = std::min(count, first_size);
+            first += from_first;
+            first_size -= from_first;
+            count -= from_first;
+            second += count;
+            second_size -= count;
+        }
+        return true;
+    }
+    detail::fd_offset seek(detail::fd_offset offset, int whence)
+    {
+        stats_.seek_calls++;
+        position_ = detail::fd_seek(fd_, offset, whence);
+        return position_;
+    }
+    void advance_position(std::ptrdiff_t count) noexcept
+    {
+        if(position_ >= 0)
+            position_ += count;
+    }
+    /// Drop cached pages before the file position less the \a in_use bytes just read, see file_options::drop_behind
+    void drop_behind(std::ptrdiff_t in_use, bool written)
+    {
+        const detail::fd_offset position = position_ >= 0 ? position_ : seek(0, SEEK_CUR);
+        if(position < 0)
+            return;
+        const detail::fd_offset end = position - in_use;
+        if(end < drop_pending_)
+        {
+            // Moved backwards
+            drop_from_ = std::min(drop_from_, end);
+            drop_done_ = std::min(drop_done_, end);
+            drop_pending_ = end;
+        }
+        if(end - drop_pending_ < detail::fd_offset(drop_behind_size))
+            return;
+        // Large folios are only dropped if they are completely in the range, so it starts at the beginning of the
+        // largest folio which may contain the end of the previous range, but not before the streamed region
+        const detail::fd_offset folio_size = detail::fd_offset(drop_behind_folio_size);
+        const detail::fd_offset start = std::max(drop_from_, drop_done_ / folio_size * folio_size);
+        if(written)
+        {
+            // Dirty pages can't be dropped. Start writing back the new range, the previous one was started
+            // a megabyte ago and is likely written back already.
+            detail::fd_writeback(fd_, drop_pending_, end - drop_pending_, false);
+            if(drop_pending_ > drop_done_)
+            {
+                detail::fd_writeback(fd_, start, drop_pending_ - start, true);
+                detail::fd_advise(fd_, start, drop_pending_ - start, file_advice::dont_need);
+                drop_done_ = drop_pending_;
+            }
+        } else
+        {
+            detail::fd_advise(fd_, start, end - start, file_advice::dont_need);
+            drop_done_ = end;
+        }
+        drop_pending_ = end;
+    }
+
+    /// Write the put area, which stays active
+    bool flush_output()
+    {
+        if(pptr() == pbase())
+            return true;
+        if(direct_)
+            return write_direct();
+        const bool result = write_all(pbase(), static_cast<std::size_t>(pptr() - pbase()));
+        setp(pbase(), epptr());
+        return result;
+    }
+    ///
+    /// Write the put area with direct I/O. It starts as far from the aligned buffer as the file position from the
+    /// start of its block, so whole blocks are written from aligned memory and only partial blocks at the start and
+    /// end go through the page cache.
+    ///
+    bool write_direct()
+    {
+        const std::size_t offset = static_cast<std::size_t>(pbase() - buffer_);
+        const std::size_t size = static_cast<std::size_t>(pptr() - pbase());
+        const std::size_t head = offset ? std::min(size, direct_io_alignment - offset) : 0;
+        const std::size_t blocks = (size - head) / direct_io_alignment * direct_io_alignment;
+        const std::size_t tail = size - head - blocks;
+        const bool result = write_cached(pbase(), head) && write_all(pbase() + head, blocks)
+                            && write_cached(pbase() + head + blocks, tail);
+        setp(buffer_ + (offset + size) % direct_io_alignment, buffer_ + buffer_size_);
+        return result;
+    }
+    /// Write a partial block, which direct I/O can't do, through the page cache
+    bool write_cached(const char* data, std::size_t size)
+    {
+        if(!size)
+            return true;
+        if(!detail::fd_set_direct(fd_, false))
+            return false;
+        const bool result = write_all(data, size);
+        return detail::fd_set_direct(fd_, true) && result;
+    }
+    /// Write the put area and move back over unread input, so the file position matches the stream position
+    bool reset_buffer()
+    {
+        bool result = true;
+        if(pbase())
+        {
+            result = flush_output();
+            setp(nullptr, nullptr);
+        }
+        result = end_hole() && result;
+        if(gptr() != egptr())
+            result = seek(-detail::fd_offset(egptr() - gptr()), SEEK_CUR) >= 0 && result;
+        setg(nullptr, nullptr, nullptr);
+        return result;
+    }
+
+    int fd_{-1};
+    std::ios_base::openmode mode_{};
+    std::size_t buffer_size_{default_buffer_size};
+    char* buffer_{nullptr};
+    std::unique_ptr<char[]> owned_buffer_;
+    io_statistics stats_;
+    bool direct_{false};
+    bool sparse_{false};
+    bool hole_at_end_{false};
+    /// File position as far as known from the calls issued, -1 if it has to be queried
+    detail::fd_offset position_{0};
+    static constexpr std::size_t drop_behind_size = 1024 * 1024;
+    /// Largest page cache folio expected, e.g. a huge page
+    static constexpr std::size_t drop_behind_folio_size = 2 * 1024 * 1024;
+    bool drop_behind_{false};
+    /// Start of the streamed region, the end of the part of it which was dropped and of the part which is being
+    /// written back
+    detail::fd_offset drop_from_{0};
+    detail::fd_offset drop_done_{0};
+    detail::fd_offset drop_pending_{0};
+}; // fd_filebuf
+
+inline void swap(fd_filebuf& lhs, fd_filebuf& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+/// \cond INTERNAL
+namespace detail {
+    /// Holds the fd_filebuf so it is constructed before the stream using it
+    struct fd_filebuf_holder
+    {
+        fd_filebuf buf_;
+    };
+
+    ///
+    /// File stream of type \tparam StreamBase using an fd_filebuf
+    ///
+    /// Files are opened with \tparam DefaultMode if no mode is given, \tparam ModeModifier is always added.
+    /// Additional file_options like direct I/O can be passed after the mode.
+    ///
+    template<typename StreamBase, std::ios_base::openmode DefaultMode, std::ios_base::openmode ModeModifier>
+    class fd_fstream_impl : private fd_filebuf_holder, public StreamBase
+    {
+    public:
+        fd_fstream_impl() : StreamBase(&buf_)
+        {}
+        explicit fd_fstream_impl(const char* file_name,
+                                 std::ios_base::openmode mode = DefaultMode,
+                                 file_options options = file_options::none) :
+            fd_fstream_impl()
+        {
+            open(file_name, mode, options);
+        }
+        explicit fd_fstream_impl(const std::string& file_name,
+                                 std::ios_base::openmode mode = DefaultMode,
+                                 file_options options = file_options::none) :
+            fd_fstream_impl()
+        {
+            open(file_name, mode, options);
+        }
+#ifdef NOWIDE_WINDOWS
+        explicit fd_fstream_impl(const wchar_t* file_name,
+                                 std::ios_base::openmode mode = DefaultMode,
+                                 file_options options = file_options::none) :
+            fd_fstream_impl()
+        {
+            open(file_name, mode, options);
+        }
+#endif
+        fd_fstream_impl(const fd_fstream_impl&) = delete;
+        fd_fstream_impl& operator=(const fd_fstream_impl&) = delete;
+        fd_fstream_impl(fd_fstream_impl&& other) noexcept :
+            fd_filebuf_holder(std::move(other)), StreamBase(std::move(other))
+        {
+            this->set_rdbuf(&buf_);
+        }
+        fd_fstream_impl& operator=(fd_fstream_impl&& rhs)
+        {
+            fd_filebuf_holder::operator=(std::move(rhs));
+            StreamBase::operator=(std::move(rhs));
+            return *this;
+        }
+        void swap(fd_fstream_impl& other)
+        {
+            StreamBase::swap(other);
+            buf_.swap(other.buf_);
+        }
+
+        void open(const char* file_name,
+                  std::ios_base::openmode mode = DefaultMode,
+                  file_options options = file_options::none)
+        {
+            check_open(buf_.open(file_name, mode | ModeModifier, options));
+        }
+        void open(const std::string& file_name,
+                  std::ios_base::openmode mode = DefaultMode,
+                  file_options options = file_options::none)
+        {
+            open(file_name.c_str(), mode, options);
+        }
+#ifdef NOWIDE_WINDOWS
+        void open(const wchar_t* file_name,
+                  std::ios_base::openmode mode = DefaultMode,
+                  file_options options = file_options::none)
+        {
+            check_open(buf_.open(file_name, mode | ModeModifier, options));
+        }
+#endif
+        bool is_open() const
+        {
+            return buf_.is_open();
+        }
+        void close()
+        {
+            if(!buf_.close())
+                this->setstate(std::ios_base::failbit);
+        }
+        fd_filebuf* rdbuf() const
+        {
+            return const_cast<fd_filebuf*>(&buf_);
+        }
+
+    private:
+        void check_open(const fd_filebuf* result)
+        {
+            if(!result)
+                this->setstate(std::ios_base::failbit);
+            else
+                this->clear();
+        }
+    };
+} // namespace detail
+/// \endcond
+
+///
+/// Input file stream using an fd_filebuf
+///
+using fd_ifstream = detail::fd_fstream_impl<std::istream, std::ios_base::in, std::ios_base::in>;
+///
+/// Output file stream using an fd_filebuf
+///
+using fd_ofstream = detail::fd_fstream_impl<std::ostream, std::ios_base::out, std::ios_base::out>;
+///
+/// Input and output file stream using an fd_filebuf
+///
+using fd_fstream =
+  detail::fd_fstream_impl<std::iostream, std::ios_base::in | std::ios_base::out, std::ios_base::openmode{}>;
+
+} // namespace nowide
+
+#endif
@@ -0,0 +1,290 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_FILE_IO_HPP_INCLUDED
+#define NOWIDE_FILE_IO_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <nowide/config.hpp>
+#include <nowide/fd_filebuf.hpp>
+#include <nowide/filesystem.hpp>
+#include <nowide/mapped_file.hpp>
+#include <nowide/replacement.hpp>
+#include <nowide/utf/convert.hpp>
+#include <nowide/utf/endian.hpp>
+#include <string>
+#include <string_view>
+#if __has_include(<version>)
+#include <version>
+#endif
+
+namespace nowide {
+///
+/// \brief Encoding of the content of a file read by read_file()
+///
+enum class file_encoding
+{
+    /// Bytes read unchanged, e.g. UTF-8
+    utf8,
+    /// UTF-16 in the byte order given by a byte order mark, which is removed, or little endian without one
+    utf16,
+    utf16le,
+    utf16be
+};
+
+/// \cond INTERNAL
+namespace detail {
+    /// Closes a file descriptor when leaving the scope
+    struct fd_closer
+    {
+        int fd;
+        ~fd_closer()
+        {
+            fd_close(fd);
+        }
+    };
+
+    /// Size of the blocks UTF-16 files are read and converted in, and of the first read of files of unknown size
+    constexpr std::size_t read_block_size = 64 * 1024;
+
+    ///
+    /// Make \a content \a size characters long if it is shorter, for overwriting the new characters.
+    /// They are left uninitialized where supported, otherwise the whole growth is zero-filled once.
+    ///
+    inline void grow_for_overwrite(std::string& content, std::size_t size)
+    {
+        if(size <= content.size())
+            return;
+#ifdef __cpp_lib_string_resize_and_overwrite
+        content.resize_and_overwrite(size, [](char*, std::size_t n) noexcept { return n; });
+#else
+        content.resize(size);
+#endif
+    }
+
+    ///
+    /// Read everything \a read(buffer, size) returns into \a content until it returns 0, return false if it fails.
+    /// \a size_hint is the expected size, e.g. of a regular file. A call may return less than asked for even
+    /// before the end, e.g. at most 2 GiB on Linux, so the room is allocated once only for the hint plus one byte,
+    /// which lets the call finding the end fit into it.
+    ///
+    template<typename Read>
+    bool read_all(std::string& content, std::size_t size_hint, Read read)
+    {
+        content.clear();
+        grow_for_overwrite(content, size_hint ? size_hint + 1 : read_block_size);
+        std::size_t length = 0;
+        for(;;)
+        {
+            if(length == content.size())
+                grow_for_overwrite(content, 2 * length);
+            const std::ptrdiff_t count = read(&content[length], content.size() - length);
+            if(count < 0)
+            {
+                content.clear();
+                return false;
+            }
+            if(count == 0)
+                break;
+            length += static_cast<std::size_t>(count);
+        }
+        content.resize(length);
+        return true;
+    }
+
+    inline bool read_fd(int fd, std::string& content)
+    {
+        // Files of unknown size include those claiming to be empty like the ones in /proc
+        const std::int64_t size = regular_file_size(fd);
+        return read_all(content, size > 0 ? static_cast<std::size_t>(size) : 0, [fd](char* buffer, std::size_t n) {
+            return fd_read(fd, buffer, n);
+        });
+    }
+
+    ///
+    /// Convert UTF-16 read from \a fd block by block to UTF-8 written over \a content, which is grown as needed.
+    /// [\a block, \a block + \a available) was read already.
+    ///
+    template<typename Unit>
+    bool read_fd_utf16(int fd, std::string& content, char* block, std::size_t available)
+    {
+        std::size_t length = 0;
+        for(;;)
+        {
+            // The block may be full already after detecting a byte order mark
+            bool at_end = false;
+            if(available < read_block_size)
+            {
+                const std::ptrdiff_t count = fd_read(fd, block + available, read_block_size - available);
+                if(count < 0)
+                    return false;
+                at_end = count == 0;
+                available += static_cast<std::size_t>(count);
+            }
+            const Unit* begin = reinterpret_cast<const Unit*>(block);
+            const Unit* const end = begin + available / sizeof(Unit);
+            // Keep a surrogate pair cut short by the end of the block for the next one
+            const Unit* const complete = at_end ? end : utf::complete_sequences_end(begin, end);
+            // At most 3 bytes per code unit
+            const std::size_t max_size = length + 3 * static_cast<std::size_t>(complete - begin);
+            if(max_size > content.size())
+                grow_for_overwrite(content, std::max(max_size, 2 * content.size()));
+            char* out = &content[length];
+            utf::convert_prefix(out, &content[0] + max_size, begin, complete);
+            length = static_cast<std::size_t>(out - content.data());
+            const std::size_t consumed = static_cast<std::size_t>(complete - reinterpret_cast<const Unit*>(block));
+            available -= consumed * sizeof(Unit);
+            if(at_end)
+            {
+                content.resize(length);
+                // An odd trailing byte is no code unit
+                if(available)
+                    utf::utf_traits<char>::encode(NOWIDE_REPLACEMENT_CHARACTER, std::back_inserter(content));
+                return true;
+            }
+            std::memmove(block, block + consumed * sizeof(Unit), available);
+        }
+    }
+
+    template<typename CharType>
+    bool read_file(const CharType* file_name, std::string& content, file_encoding encoding)
+    {
+        const int fd = fd_open(file_name, fd_rdonly);
+        if(fd < 0)
+        {
+            content.clear();
+            return false;
+        }
+        const fd_closer closer{fd};
+        if(encoding == file_encoding::utf8)
+            return read_fd(fd, content);
+        content.clear();
+        // Exact for ASCII text with room for converting the last block, so usually allocated once
+        const std::int64_t size = regular_file_size(fd);
+        if(size > 0)
+            grow_for_overwrite(content, static_cast<std::size_t>(size) / 2 + 3 * read_block_size / 2);
+        std::unique_ptr<char[]> block(new char[read_block_size]);
+        // Read enough for a byte order mark
+        std::size_t available = 0;
+        while(available < 2)
+        {
+            const std::ptrdiff_t count = fd_read(fd, block.get() + available, read_block_size - available);
+            if(count < 0)
+                return false;
+            if(!count)
+                break;
+            available += static_cast<std::size_t>(count);
+        }
+        bool big_endian = encoding == file_encoding::utf16be;
+        if(encoding == file_encoding::utf16 && available >= 2)
+        {
+            const unsigned char first = static_cast<unsigned char>(block[0]);
+            const unsigned char second = static_cast<unsigned char>(block[1]);
+            if((first == 0xFE && second == 0xFF) || (first == 0xFF && second == 0xFE))
+            {
+                big_endian = first == 0xFE;
+                available -= 2;
+                std::memmove(block.get(), block.get() + 2, available);
+            }
+        }
+        const bool result = big_endian ? read_fd_utf16<utf::be16>(fd, content, block.get(), available)
+                                       : read_fd_utf16<utf::le16>(fd, content, block.get(), available);
+        if(!result)
+            content.clear();
+        return result;
+    }
+
+    template<typename CharType>
+    bool write_file(const CharType* file_name, std::string_view data)
+    {
+        const int fd = fd_open(file_name, fd_wronly | fd_creat | fd_trunc);
+        if(fd < 0)
+            return false;
+        bool result = true;
+        for(std::size_t pos = 0; pos < data.size() && result;)
+        {
+            const std::ptrdiff_t written = fd_write(fd, data.data() + pos, data.size() - pos);
+            result = written > 0;
+            pos += static_cast<std::size_t>(written);
+        }
+        return fd_close(fd) == 0 && result;
+    }
+} // namespace detail
+/// \endcond
+
+///
+/// Read the whole file \a file_name into \a content, replacing its previous content
+///
+/// The size of regular files is determined first, so the content is allocated once and usually read with one
+/// system call, plus one finding the end. With a UTF-16 \a encoding the file is converted to UTF-8 block by block
+/// while reading it.
+/// Any illegal sequences are replaced with the replacement character, see #NOWIDE_REPLACEMENT_CHARACTER
+///
+/// \return true on success, false if the file couldn't be opened or read, \a content is empty then
+///
+inline bool read_file(const char* file_name, std::string& content, file_encoding encoding = file_encoding::utf8)
+{
+#ifdef NOWIDE_WINDOWS
+    const wstackstring name(file_name);
+    return detail::read_file(name.data(), content, encoding);
+#else
+    return detail::read_file(file_name, content, encoding);
+#endif
+}
+inline bool
+read_file(const std::string& file_name, std::string& content, file_encoding encoding = file_encoding::utf8)
+{
+    return read_file(file_name.c_str(), content, encoding);
+}
+#ifdef NOWIDE_WINDOWS
+inline bool read_file(const wchar_t* file_name, std::string& content, file_encoding encoding = file_encoding::utf8)
+{
+    return detail::read_file(file_name, content, encoding);
+}
+#endif
+inline bool
+read_file(const filesystem::path& file_name, std::string& content, file_encoding encoding = file_encoding::utf8)
+{
+    return detail::read_file(file_name.c_str(), content, encoding);
+}
+
+///
+/// Replace the content of the file \a file_name with \a data, creating the file if it doesn't exist
+///
+/// \return true on success, false if the file couldn't be opened, written or closed
+///
+inline bool write_file(const char* file_name, std::string_view data)
+{
+#ifdef NOWIDE_WINDOWS
+    const wstackstring name(file_name);
+    return detail::write_file(name.data(), data);
+#else
+    return detail::write_file(file_name, data);
+#endif
+}
+inline bool write_file(const std::string& file_name, std::string_view data)
+{
+    return write_file(file_name.c_str(), data);
+}
+#ifdef NOWIDE_WINDOWS
+inline bool write_file(const wchar_t* file_name, std::string_view data)
+{
+    return detail::write_file(file_name, data);
+}
+#endif
+inline bool write_file(const filesystem::path& file_name, std::string_view data)
+{
+    return detail::write_file(file_name.c_str(), data);
+}
+} // namespace nowide
+
+#endif
@@ -17,11 +17,16 @@
 #include <nowide/stackstring.hpp>
 #endif
 #include <fstream>
+#ifdef NOWIDE_USE_FD_FILEBUF
+#include <nowide/fd_filebuf.hpp>
+#endif
 
 namespace nowide {
 #ifndef NOWIDE_WINDOWS
 using std::basic_filebuf;
+#ifndef NOWIDE_USE_FD_FILEBUF
 using std::filebuf;
+#endif
 #else // Windows
 ///
 /// \brief The basic_filebuf type.
@@ -54,13 +59,22 @@ public:
     }
 };
 
+#ifndef NOWIDE_USE_FD_FILEBUF
 ///
 /// \brief Convenience typedef
 ///
 using filebuf = basic_filebuf<char>;
+#endif
 
 #endif // windows
 
+#ifdef NOWIDE_USE_FD_FILEBUF
+///
+/// \brief The char file buffer is fd_filebuf if NOWIDE_USE_FD_FILEBUF is defined
+///
+using filebuf = fd_filebuf;
+#endif
+
 } // namespace nowide
 
 #endif
@@ -19,9 +19,11 @@ namespace nowide {
 using std::basic_ifstream;
 using std::basic_ofstream;
 using std::basic_fstream;
+#ifndef NOWIDE_USE_FD_FILEBUF
 using std::ifstream;
 using std::ofstream;
 using std::fstream;
+#endif
 #else
 /// \cond INTERNAL
 namespace detail {
@@ -132,6 +134,7 @@ public:
     }
 };
 
+#ifndef NOWIDE_USE_FD_FILEBUF
 ///
 /// Same as std::ifstream but accepts UTF-8 strings under Windows
 ///
@@ -144,6 +147,7 @@ using ofstream = basic_ofstream<char>;
 /// Same as std::fstream but accepts UTF-8 strings under Windows
 ///
 using fstream = basic_fstream<char>;
+#endif
 
 // Implementation
 namespace detail {
@@ -252,6 +256,21 @@ namespace detail {
 
 #endif // windows
 
+#ifdef NOWIDE_USE_FD_FILEBUF
+///
+/// Input file stream using fd_filebuf if NOWIDE_USE_FD_FILEBUF is defined
+///
+using ifstream = fd_ifstream;
+///
+/// Output file stream using fd_filebuf if NOWIDE_USE_FD_FILEBUF is defined
+///
+using ofstream = fd_ofstream;
+///
+/// Input and output file stream using fd_filebuf if NOWIDE_USE_FD_FILEBUF is defined
+///
+using fstream = fd_fstream;
+#endif
+
 } // namespace nowide
 
 #endif
@@ -0,0 +1,236 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_INTERN_POOL_HPP_INCLUDED
+#define NOWIDE_INTERN_POOL_HPP_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <nowide/convert.hpp>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace nowide {
+///
+/// \brief A pool storing each distinct string once in both its narrow (UTF-8) and wide (UTF-16/32) form
+///
+/// Strings, usually paths, are interned into an arena and identified by a small integer handle.
+/// Equal strings get equal handles, so they can be compared by handle and either encoding can be fetched
+/// without converting again. All returned pointers and views stay valid until the pool is cleared or destroyed.
+///
+/// Invalid UTF-8 is replaced by the substitution character (see #NOWIDE_REPLACEMENT_CHARACTER) in the
+/// wide form, the narrow form is stored as passed.
+///
+/// This class is not thread safe, guard it with a mutex if it is shared between threads.
+///
+class intern_pool
+{
+public:
+    /// Handle to an interned string
+    using handle = std::uint32_t;
+
+    /// Create an empty pool allocating arena blocks of at least \a block_size bytes
+    explicit intern_pool(std::size_t block_size = 64 * 1024) : block_size_(block_size)
+    {}
+
+    intern_pool(const intern_pool&) = delete;
+    intern_pool& operator=(const intern_pool&) = delete;
+    intern_pool(intern_pool&&) = default;
+    intern_pool& operator=(intern_pool&&) = default;
+
+    /// Intern the UTF-8 string \a s and return its handle
+    /// \throws std::length_error if the pool already holds as many strings as there are handles
+    handle intern(std::string_view s)
+    {
+        const auto it = index_.find(s);
+        if(it != index_.end())
+            return it->second;
+        check_size();
+        return add(std::string_view(copy_to_arena(s.data(), s.size()), s.size()));
+    }
+    /// Intern the wide string \a s and return its handle
+    /// \throws std::length_error if the pool already holds as many strings as there are handles
+    handle intern(std::wstring_view s)
+    {
+        // Convert into the arena and keep it only if the string is new
+        char* const narrow = reserve_arena<char>(s.size() * utf::utf_traits<char>::max_width);
+        const std::string_view key(narrow, convert_to_arena(narrow, s) - narrow);
+        const auto it = index_.find(key);
+        if(it != index_.end())
+            return it->second;
+        check_size();
+        commit_arena(narrow + key.size());
+        return add(key);
+    }
+
+    /// Return the handle of \a s if it was interned before
+    /// \return true on success
+    bool find(std::string_view s, handle& h) const
+    {
+        const auto it = index_.find(s);
+        if(it == index_.end())
+            return false;
+        h = it->second;
+        return true;
+    }
+
+    /// Return the NULL terminated UTF-8 form of \a h
+    const char* c_str(handle h) const noexcept
+    {
+        return entries_[h].narrow;
+    }
+    /// Return the NULL terminated wide form of \a h
+    const wchar_t* wc_str(handle h) const noexcept
+    {
+        return entries_[h].wide;
+    }
+    /// Return the UTF-8 form of \a h
+    std::string_view narrow(handle h) const noexcept
+    {
+        return {entries_[h].narrow, entries_[h].narrow_size};
+    }
+    /// Return the wide form of \a h
+    std::wstring_view wide(handle h) const noexcept
+    {
+        return {entries_[h].wide, entries_[h].wide_size};
+    }
+
+    /// Return the number of distinct strings in the pool
+    std::size_t size() const noexcept
+    {
+        return entries_.size();
+    }
+    /// Return the number of bytes allocated for the string arena
+    std::size_t arena_bytes() const noexcept
+    {
+        return arena_bytes_;
+    }
+    /// Return an estimate of the total number of bytes used by the pool including its lookup structures
+    std::size_t memory_usage() const noexcept
+    {
+        // Hash nodes hold the key, the handle and a next pointer plus a bucket pointer each
+        const std::size_t index_bytes = index_.bucket_count() * sizeof(void*)
+                                        + index_.size() * (sizeof(std::string_view) + sizeof(handle) + sizeof(void*));
+        return sizeof(*this) + arena_bytes_ + entries_.size() * sizeof(entry) + blocks_.capacity() * sizeof(block)
+               + index_bytes;
+    }
+
+    /// Remove all strings, invalidating all handles, pointers and views
+    void clear() noexcept
+    {
+        index_.clear();
+        entries_.clear();
+        blocks_.clear();
+        arena_bytes_ = 0;
+        block_pos_ = 0;
+    }
+
+private:
+    struct entry
+    {
+        const char* narrow;
+        std::size_t narrow_size;
+        const wchar_t* wide;
+        std::size_t wide_size;
+    };
+    struct block
+    {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+    };
+
+    void check_size() const
+    {
+        if(entries_.size() > std::numeric_limits<handle>::max())
+            throw std::length_error("intern_pool: too many strings");
+    }
+
+    /// Add an entry for \a narrow, which was put into the arena already
+    handle add(std::string_view narrow)
+    {
+        entry e;
+        e.narrow = narrow.data();
+        e.narrow_size = narrow.size();
+        wchar_t* const wide = reserve_arena<wchar_t>(narrow.size() * utf::utf_traits<wchar_t>::max_width);
+        e.wide = wide;
+        e.wide_size = convert_to_arena(wide, narrow) - wide;
+        commit_arena(wide + e.wide_size);
+
+        const handle h = static_cast<handle>(entries_.size());
+        entries_.push_back(e);
+        index_.emplace(narrow, h);
+        return h;
+    }
+
+    ///
+    /// Return room for \a size characters and a NULL terminator at the end of the arena
+    ///
+    /// The room is taken by commit_arena(), so it is reused by the next reservation if that isn't called.
+    ///
+    template<typename CharType>
+    CharType* reserve_arena(std::size_t size)
+    {
+        const std::size_t bytes = (size + 1) * sizeof(CharType);
+        // Align the current position for CharType
+        std::size_t pos = (block_pos_ + alignof(CharType) - 1) & ~(alignof(CharType) - 1);
+        if(blocks_.empty() || pos + bytes > blocks_.back().size)
+        {
+            const std::size_t new_size = std::max(block_size_, bytes);
+            blocks_.push_back(block{std::unique_ptr<unsigned char[]>(new unsigned char[new_size]), new_size});
+            arena_bytes_ += new_size;
+            block_pos_ = 0;
+            pos = 0;
+        }
+        return reinterpret_cast<CharType*>(blocks_.back().data.get() + pos);
+    }
+    /// Terminate the string ending at \a end in the reserved room and take the room up to there
+    template<typename CharType>
+    void commit_arena(CharType* end) noexcept
+    {
+        *end = 0;
+        block_pos_ = static_cast<std::size_t>(reinterpret_cast<unsigned char*>(end + 1) - blocks_.back().data.get());
+    }
+    /// Convert \a s into the room reserved at \a out for the maximum converted size, return the end
+    template<typename CharOut, typename CharIn>
+    static CharOut* convert_to_arena(CharOut* out, std::basic_string_view<CharIn> s) noexcept
+    {
+        const CharIn* begin = s.data();
+        const bool success =
+          utf::convert_prefix(out, out + s.size() * utf::utf_traits<CharOut>::max_width, begin, s.data() + s.size());
+        assert(success);
+        (void)success;
+        return out;
+    }
+    /// Copy [s, s + size) and a NULL terminator into the arena
+    template<typename CharType>
+    const CharType* copy_to_arena(const CharType* s, std::size_t size)
+    {
+        CharType* const result = reserve_arena<CharType>(size);
+        if(size)
+            std::memcpy(result, s, size * sizeof(CharType));
+        commit_arena(result + size);
+        return result;
+    }
+
+    std::size_t block_size_;
+    std::vector<block> blocks_;
+    std::size_t block_pos_{0};
+    std::size_t arena_bytes_{0};
+    std::deque<entry> entries_;
+    std::unordered_map<std::string_view, handle> index_;
+}; // intern_pool
+
+} // namespace nowide
+
+#endif
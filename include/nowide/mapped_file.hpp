@@ -0,0 +1,431 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_MAPPED_FILE_HPP_INCLUDED
+#define NOWIDE_MAPPED_FILE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <nowide/config.hpp>
+#include <nowide/fd_filebuf.hpp>
+#include <nowide/filesystem.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#if __has_include(<version>)
+#include <version>
+#endif
+#ifdef __cpp_lib_span
+#include <span>
+#endif
+#ifndef NOWIDE_WINDOWS
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nowide {
+///
+/// \brief Access to a mapped_file
+///
+enum class map_access
+{
+    /// The mapping can only be read
+    read_only,
+    /// Writes to the mapping change the file
+    read_write
+};
+
+///
+/// \brief Options for mapping a file, which can be combined with |
+///
+/// All options are hints which are ignored where not supported.
+///
+enum class map_options : unsigned
+{
+    none = 0,
+    /// Read the whole file into memory when mapping it, e.g. MAP_POPULATE on Linux
+    populate = 1,
+    /// Use huge pages for the mapping if the file system supports them, e.g. MADV_HUGEPAGE on Linux
+    huge_pages = 2
+};
+constexpr map_options operator|(map_options lhs, map_options rhs) noexcept
+{
+    return map_options(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+}
+constexpr map_options operator&(map_options lhs, map_options rhs) noexcept
+{
+    return map_options(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+}
+
+///
+/// \brief Expected access pattern of a mapped_file, see mapped_file::advise()
+///
+enum class map_advice
+{
+    normal,
+    sequential,
+    random,
+    /// The whole file will be accessed soon
+    will_need,
+    /// The pages are not needed for now and may be dropped from memory
+    dont_need
+};
+
+/// \cond INTERNAL
+namespace detail {
+#ifndef NOWIDE_WINDOWS
+    /// Return the size of the regular file \a fd or -1 if it isn't a regular file
+    inline std::int64_t regular_file_size(int fd) noexcept
+    {
+        struct stat st;
+        if(::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+            return -1;
+        return static_cast<std::int64_t>(st.st_size);
+    }
+    /// Map the first \a size bytes of the file \a fd, return NULL on failure
+    inline void* map_file(int fd,
+                          std::size_t size,
+                          map_access access = map_access::read_only,
+                          map_options options = map_options::none) noexcept
+    {
+        int flags = access == map_access::read_only ? MAP_PRIVATE : MAP_SHARED;
+#ifdef MAP_POPULATE
+        if((options & map_options::populate) != map_options::none)
+            flags |= MAP_POPULATE;
+#endif
+        const int protection = access == map_access::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+        void* const address = ::mmap(nullptr, size, protection, flags, fd, 0);
+        if(address == MAP_FAILED)
+            return nullptr;
+#ifdef MADV_HUGEPAGE
+        if((options & map_options::huge_pages) != map_options::none)
+            ::madvise(address, size, MADV_HUGEPAGE);
+#endif
+        return address;
+    }
+    inline void unmap_file(void* address, std::size_t size) noexcept
+    {
+        ::munmap(address, size);
+    }
+    /// Write changes of the mapping to the file \a fd, return false on error
+    inline bool flush_mapping(int /*fd*/, void* address, std::size_t size) noexcept
+    {
+        return ::msync(address, size, MS_SYNC) == 0;
+    }
+    inline bool advise_mapping(void* address, std::size_t size, map_advice advice) noexcept
+    {
+        int value = MADV_NORMAL;
+        switch(advice)
+        {
+        case map_advice::normal: break;
+        case map_advice::sequential: value = MADV_SEQUENTIAL; break;
+        case map_advice::random: value = MADV_RANDOM; break;
+        case map_advice::will_need: value = MADV_WILLNEED; break;
+        case map_advice::dont_need: value = MADV_DONTNEED; break;
+        }
+        return ::madvise(address, size, value) == 0;
+    }
+    inline bool resize_file(int fd, std::uint64_t size) noexcept
+    {
+        int result;
+        do
+            result = ::ftruncate(fd, static_cast<off_t>(size));
+        while(result != 0 && errno == EINTR);
+        return result == 0;
+    }
+#else
+    NOWIDE_DECL std::int64_t regular_file_size(int fd) noexcept;
+    NOWIDE_DECL void* map_file(int fd,
+                               std::size_t size,
+                               map_access access = map_access::read_only,
+                               map_options options = map_options::none) noexcept;
+    NOWIDE_DECL void unmap_file(void* address, std::size_t size) noexcept;
+    NOWIDE_DECL bool flush_mapping(int fd, void* address, std::size_t size) noexcept;
+    NOWIDE_DECL bool advise_mapping(void* address, std::size_t size, map_advice advice) noexcept;
+    NOWIDE_DECL bool resize_file(int fd, std::uint64_t size) noexcept;
+#endif
+} // namespace detail
+/// \endcond
+
+///
+/// \brief A regular file mapped into memory as a whole
+///
+/// The contents are accessed directly through data() and view(), or bytes() if std::span is available,
+/// without copying them. File names are UTF-8 on all platforms. Empty files are supported and have no mapping.
+///
+/// The mapping keeps the size the file had when it was mapped. Use remap() to pick up a changed size,
+/// e.g. of a growing file, or resize() to change the size of a file mapped with map_access::read_write.
+/// Accessing pages beyond the end of a truncated file is undefined.
+///
+class mapped_file
+{
+public:
+    mapped_file() = default;
+    explicit mapped_file(const char* file_name,
+                         map_access access = map_access::read_only,
+                         map_options options = map_options::none)
+    {
+        open(file_name, access, options);
+    }
+    explicit mapped_file(const std::string& file_name,
+                         map_access access = map_access::read_only,
+                         map_options options = map_options::none)
+    {
+        open(file_name, access, options);
+    }
+#ifdef NOWIDE_WINDOWS
+    explicit mapped_file(const wchar_t* file_name,
+                         map_access access = map_access::read_only,
+                         map_options options = map_options::none)
+    {
+        open(file_name, access, options);
+    }
+#endif
+    explicit mapped_file(const filesystem::path& file_name,
+                         map_access access = map_access::read_only,
+                         map_options options = map_options::none)
+    {
+        open(file_name, access, options);
+    }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept :
+        fd_(std::exchange(other.fd_, -1)), access_(other.access_), options_(other.options_),
+        data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+    {}
+    mapped_file& operator=(mapped_file&& rhs) noexcept
+    {
+        swap(rhs);
+        rhs.close();
+        return *this;
+    }
+    ~mapped_file()
+    {
+        close();
+    }
+    void swap(mapped_file& other) noexcept
+    {
+        std::swap(fd_, other.fd_);
+        std::swap(access_, other.access_);
+        std::swap(options_, other.options_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+
+    ///
+    /// Open and map the regular file \a file_name
+    ///
+    /// \return false if the file couldn't be opened or mapped, e.g. because it isn't a regular file,
+    /// or if a file is already open
+    ///
+    bool open(const char* file_name,
+              map_access access = map_access::read_only,
+              map_options options = map_options::none)
+    {
+#ifdef NOWIDE_WINDOWS
+        const wstackstring name(file_name);
+        return open_native(name.data(), access, options);
+#else
+        return open_native(file_name, access, options);
+#endif
+    }
+    bool open(const std::string& file_name,
+              map_access access = map_access::read_only,
+              map_options options = map_options::none)
+    {
+        return open(file_name.c_str(), access, options);
+    }
+#ifdef NOWIDE_WINDOWS
+    bool open(const wchar_t* file_name,
+              map_access access = map_access::read_only,
+              map_options options = map_options::none)
+    {
+        return open_native(file_name, access, options);
+    }
+#endif
+    bool open(const filesystem::path& file_name,
+              map_access access = map_access::read_only,
+              map_options options = map_options::none)
+    {
+        return open_native(file_name.c_str(), access, options);
+    }
+    bool is_open() const noexcept
+    {
+        return fd_ >= 0;
+    }
+    ///
+    /// Unmap and close the file
+    ///
+    /// \return false if no file was open or closing failed
+    ///
+    bool close() noexcept
+    {
+        if(!is_open())
+            return false;
+        unmap();
+        const bool result = detail::fd_close(fd_) == 0;
+        fd_ = -1;
+        return result;
+    }
+
+    /// Return the access the file was opened with
+    map_access access() const noexcept
+    {
+        return access_;
+    }
+    /// Return the mapped contents or NULL if the file is empty or not open
+    const char* data() const noexcept
+    {
+        return data_;
+    }
+    /// Return the mapped contents, which must only be modified for map_access::read_write
+    char* data() noexcept
+    {
+        return data_;
+    }
+    /// Return the size of the mapping
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+    bool empty() const noexcept
+    {
+        return !size_;
+    }
+    /// Return the mapped contents as characters
+    std::string_view view() const noexcept
+    {
+        return std::string_view(data_, size_);
+    }
+#ifdef __cpp_lib_span
+    /// Return the mapped contents as bytes
+    std::span<const std::byte> bytes() const noexcept
+    {
+        return std::span<const std::byte>(reinterpret_cast<const std::byte*>(data_), size_);
+    }
+    /// Return the mapped contents as bytes, which must only be modified for map_access::read_write
+    std::span<std::byte> writable_bytes() noexcept
+    {
+        return std::span<std::byte>(reinterpret_cast<std::byte*>(data_), size_);
+    }
+#endif
+
+    ///
+    /// Map the file again if its size changed since it was mapped, e.g. because it grew
+    ///
+    /// Pointers into the previous mapping become invalid if the size changed.
+    /// \return false if the file isn't open or couldn't be mapped, which leaves it open but empty
+    ///
+    bool remap()
+    {
+        if(!is_open())
+            return false;
+        const std::int64_t size = detail::regular_file_size(fd_);
+        if(size < 0)
+            return false;
+        if(static_cast<std::uint64_t>(size) == size_)
+            return true;
+        unmap();
+        return map(size);
+    }
+    ///
+    /// Change the size of a file opened with map_access::read_write to \a new_size and map it again
+    ///
+    /// New bytes are zero. Pointers into the previous mapping become invalid.
+    /// \return false if the file isn't open for writing or it couldn't be resized or mapped
+    ///
+    bool resize(std::size_t new_size)
+    {
+        if(!is_open() || access_ != map_access::read_write)
+            return false;
+        // The file can't be resized while it is mapped on Windows
+        unmap();
+        const bool resized = detail::resize_file(fd_, new_size);
+        const std::int64_t size = detail::regular_file_size(fd_);
+        return map(size) && resized;
+    }
+    ///
+    /// Write changes to the file and wait until they are stored
+    ///
+    bool flush() noexcept
+    {
+        return is_open() && (!data_ || access_ == map_access::read_only || detail::flush_mapping(fd_, data_, size_));
+    }
+    ///
+    /// Tell the system how the mapping will be accessed, see map_advice. Ignored on Windows.
+    ///
+    bool advise(map_advice advice) noexcept
+    {
+        return is_open() && (!data_ || detail::advise_mapping(data_, size_, advice));
+    }
+    /// Return the file descriptor or -1 if no file is open
+    int fd() const noexcept
+    {
+        return fd_;
+    }
+
+private:
+    template<typename CharType>
+    bool open_native(const CharType* file_name, map_access access, map_options options)
+    {
+        if(is_open())
+            return false;
+        const int fd =
+          detail::fd_open(file_name, access == map_access::read_only ? detail::fd_rdonly : detail::fd_rdwr);
+        if(fd < 0)
+            return false;
+        fd_ = fd;
+        access_ = access;
+        options_ = options;
+        if(!map(detail::regular_file_size(fd)))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /// Map the first \a size bytes of the file
+    bool map(std::int64_t size) noexcept
+    {
+        if(size < 0 || static_cast<std::uint64_t>(size) > static_cast<std::uint64_t>(PTRDIFF_MAX))
+            return false;
+        // Empty files can't be mapped
+        if(!size)
+            return true;
+        void* const address = detail::map_file(fd_, static_cast<std::size_t>(size), access_, options_);
+        if(!address)
+            return false;
+        data_ = static_cast<char*>(address);
+        size_ = static_cast<std::size_t>(size);
+        return true;
+    }
+    void unmap() noexcept
+    {
+        if(data_)
+            detail::unmap_file(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    int fd_{-1};
+    map_access access_{map_access::read_only};
+    map_options options_{map_options::none};
+    char* data_{nullptr};
+    std::size_t size_{0};
+}; // mapped_file
+
+inline void swap(mapped_file& lhs, mapped_file& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+} // namespace nowide
+
+#endif
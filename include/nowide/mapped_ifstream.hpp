@@ -0,0 +1,291 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_MAPPED_IFSTREAM_HPP_INCLUDED
+#define NOWIDE_MAPPED_IFSTREAM_HPP_INCLUDED
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <nowide/config.hpp>
+#include <nowide/fd_filebuf.hpp>
+#include <nowide/filesystem.hpp>
+#include <nowide/mapped_file.hpp>
+#include <streambuf>
+#include <string>
+
+namespace nowide {
+///
+/// \brief Read-only file stream buffer using a memory mapping of the whole file as its get area
+///
+/// Reading, seeking and e.g. std::getline work directly on the mapped pages without copying them into a buffer.
+/// Files which can't be mapped, e.g. pipes, devices and empty files, are read through a buffer instead, see
+/// is_mapped().
+/// File names are UTF-8 on all platforms and the file is always accessed in binary mode.
+///
+/// The file must not be truncated while it is open, accessing pages beyond its end is undefined.
+///
+class mapped_filebuf : public std::streambuf
+{
+public:
+    /// Size of the buffer used if the file can't be mapped
+    static constexpr std::size_t buffer_size = 64 * 1024;
+
+    mapped_filebuf() = default;
+    mapped_filebuf(const mapped_filebuf&) = delete;
+    mapped_filebuf& operator=(const mapped_filebuf&) = delete;
+    ~mapped_filebuf() override
+    {
+        close();
+    }
+
+    ///
+    /// Open the file \a file_name for reading
+    ///
+    /// \return this on success, NULL if the file couldn't be opened, \a mode contains anything but
+    /// in, binary and ate or a file is already open
+    ///
+    mapped_filebuf* open(const char* file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+#ifdef NOWIDE_WINDOWS
+        const wstackstring name(file_name);
+        return open_native(name.data(), mode);
+#else
+        return open_native(file_name, mode);
+#endif
+    }
+    mapped_filebuf* open(const std::string& file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+        return open(file_name.c_str(), mode);
+    }
+#ifdef NOWIDE_WINDOWS
+    mapped_filebuf* open(const wchar_t* file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+        return open_native(file_name, mode);
+    }
+#endif
+    mapped_filebuf* open(const filesystem::path& file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+        return open_native(file_name.c_str(), mode);
+    }
+    bool is_open() const noexcept
+    {
+        return open_;
+    }
+    /// Return true if the whole file is accessed through a mapping, false if it is read through a buffer
+    bool is_mapped() const noexcept
+    {
+        return open_ && fd_ < 0;
+    }
+    ///
+    /// Unmap and close the file
+    ///
+    /// \return this on success, NULL if no file was open or closing failed
+    ///
+    mapped_filebuf* close()
+    {
+        if(!open_)
+            return nullptr;
+        bool result = true;
+        if(mapping_)
+            detail::unmap_file(mapping_, mapping_size_);
+        if(fd_ >= 0)
+            result = detail::fd_close(fd_) == 0;
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+        fd_ = -1;
+        open_ = false;
+        setg(nullptr, nullptr, nullptr);
+        return result ? this : nullptr;
+    }
+
+protected:
+    std::streamsize showmanyc() override
+    {
+        // The get area contains the whole mapped file
+        return is_mapped() ? -1 : 0;
+    }
+
+    int_type underflow() override
+    {
+        if(gptr() != egptr())
+            return traits_type::to_int_type(*gptr());
+        if(fd_ < 0)
+            return traits_type::eof();
+        if(!buffer_)
+            buffer_.reset(new char[buffer_size]);
+        const std::ptrdiff_t count = detail::fd_read(fd_, buffer_.get(), buffer_size);
+        if(count <= 0)
+            return traits_type::eof();
+        setg(buffer_.get(), buffer_.get(), buffer_.get() + count);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode /*which*/) override
+    {
+        if(!open_)
+            return pos_type(off_type(-1));
+        if(fd_ >= 0)
+        {
+            // Move back over unread input, then seek in the file
+            const int whence =
+              dir == std::ios_base::beg ? SEEK_SET : dir == std::ios_base::cur ? SEEK_CUR : SEEK_END;
+            if(dir == std::ios_base::cur)
+                off -= egptr() - gptr();
+            const detail::fd_offset result = detail::fd_seek(fd_, detail::fd_offset(off), whence);
+            if(result < 0)
+                return pos_type(off_type(-1));
+            setg(nullptr, nullptr, nullptr);
+            return pos_type(off_type(result));
+        }
+        const off_type size = egptr() - eback();
+        const off_type base = dir == std::ios_base::beg ? 0 : dir == std::ios_base::cur ? gptr() - eback() : size;
+        if(off < -base || off > size - base)
+            return pos_type(off_type(-1));
+        setg(eback(), eback() + (base + off), egptr());
+        return pos_type(base + off);
+    }
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+private:
+    template<typename CharType>
+    mapped_filebuf* open_native(const CharType* file_name, std::ios_base::openmode mode)
+    {
+        if(open_ || (mode & ~(std::ios_base::in | std::ios_base::binary | std::ios_base::ate)) != 0
+           || !(mode & std::ios_base::in))
+            return nullptr;
+        const int fd = detail::fd_open(file_name, detail::fd_rdonly);
+        if(fd < 0)
+            return nullptr;
+        const std::int64_t size = detail::regular_file_size(fd);
+        // Files claiming to be empty, e.g. in /proc, may have content, which only reading finds
+        if(size > 0 && static_cast<std::uint64_t>(size) <= static_cast<std::uint64_t>(PTRDIFF_MAX))
+        {
+            void* const mapping = detail::map_file(fd, static_cast<std::size_t>(size));
+            if(mapping)
+            {
+                detail::fd_close(fd);
+                mapping_ = mapping;
+                mapping_size_ = static_cast<std::size_t>(size);
+                char* const begin = static_cast<char*>(mapping);
+                setg(begin, begin, begin + mapping_size_);
+                fd_ = -1;
+                open_ = true;
+                if(mode & std::ios_base::ate)
+                    setg(begin, begin + mapping_size_, begin + mapping_size_);
+                return this;
+            }
+        }
+        // Read through a buffer
+        if((mode & std::ios_base::ate) && detail::fd_seek(fd, 0, SEEK_END) < 0)
+        {
+            detail::fd_close(fd);
+            return nullptr;
+        }
+        fd_ = fd;
+        open_ = true;
+        setg(nullptr, nullptr, nullptr);
+        return this;
+    }
+
+    bool open_{false};
+    int fd_{-1};
+    void* mapping_{nullptr};
+    std::size_t mapping_size_{0};
+    std::unique_ptr<char[]> buffer_;
+}; // mapped_filebuf
+
+///
+/// \brief Input file stream reading through a mapped_filebuf
+///
+/// Accepts the same UTF-8 file names as nowide::ifstream.
+///
+class mapped_ifstream : public std::istream
+{
+public:
+    mapped_ifstream() : std::istream(&buf_)
+    {}
+    explicit mapped_ifstream(const char* file_name, std::ios_base::openmode mode = std::ios_base::in) :
+        mapped_ifstream()
+    {
+        open(file_name, mode);
+    }
+    explicit mapped_ifstream(const std::string& file_name, std::ios_base::openmode mode = std::ios_base::in) :
+        mapped_ifstream()
+    {
+        open(file_name, mode);
+    }
+#ifdef NOWIDE_WINDOWS
+    explicit mapped_ifstream(const wchar_t* file_name, std::ios_base::openmode mode = std::ios_base::in) :
+        mapped_ifstream()
+    {
+        open(file_name, mode);
+    }
+#endif
+    explicit mapped_ifstream(const filesystem::path& file_name, std::ios_base::openmode mode = std::ios_base::in) :
+        mapped_ifstream()
+    {
+        open(file_name, mode);
+    }
+    mapped_ifstream(const mapped_ifstream&) = delete;
+    mapped_ifstream& operator=(const mapped_ifstream&) = delete;
+
+    void open(const char* file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+        check_open(buf_.open(file_name, mode | std::ios_base::in));
+    }
+    void open(const std::string& file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+        check_open(buf_.open(file_name, mode | std::ios_base::in));
+    }
+#ifdef NOWIDE_WINDOWS
+    void open(const wchar_t* file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+        check_open(buf_.open(file_name, mode | std::ios_base::in));
+    }
+#endif
+    void open(const filesystem::path& file_name, std::ios_base::openmode mode = std::ios_base::in)
+    {
+        check_open(buf_.open(file_name, mode | std::ios_base::in));
+    }
+    bool is_open() const
+    {
+        return buf_.is_open();
+    }
+    /// Return true if the file is mapped, see mapped_filebuf::is_mapped()
+    bool is_mapped() const
+    {
+        return buf_.is_mapped();
+    }
+    void close()
+    {
+        if(!buf_.close())
+            setstate(std::ios_base::failbit);
+    }
+    mapped_filebuf* rdbuf() const
+    {
+        return const_cast<mapped_filebuf*>(&buf_);
+    }
+
+private:
+    void check_open(const mapped_filebuf* result)
+    {
+        if(!result)
+            setstate(std::ios_base::failbit);
+        else
+            clear();
+    }
+
+    mapped_filebuf buf_;
+}; // mapped_ifstream
+
+} // namespace nowide
+
+#endif
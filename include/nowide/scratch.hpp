@@ -0,0 +1,139 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_SCRATCH_HPP_INCLUDED
+#define NOWIDE_SCRATCH_HPP_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <nowide/convert.hpp>
+#include <string_view>
+
+///
+/// \brief Conversions into thread-local, reusable buffers
+///
+/// Each thread owns one grow-only buffer per output character type. A conversion writes into that buffer
+/// and returns a view to it, so once the buffer is large enough no allocation happens at all.
+///
+/// The returned view is NULL terminated and stays valid until the next conversion to the same output character
+/// type on the same thread or until release() is called. Copy the result if it needs to live longer.
+///
+/// Any illegal sequences are replaced with the replacement character, see #NOWIDE_REPLACEMENT_CHARACTER
+///
+namespace nowide::scratch {
+/// \cond INTERNAL
+namespace detail {
+    template<typename CharType>
+    class buffer
+    {
+    public:
+        /// Return storage for at least \a size characters, previous content is lost
+        CharType* reserve(std::size_t size)
+        {
+            NOWIDE_UNLIKELY_IF(size > capacity_)
+            {
+                const std::size_t new_capacity = std::max(size, capacity_ * 2);
+                data_.reset(new CharType[new_capacity]);
+                capacity_ = new_capacity;
+            }
+            return data_.get();
+        }
+        void release() noexcept
+        {
+            data_.reset();
+            capacity_ = 0;
+        }
+        std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+    private:
+        std::unique_ptr<CharType[]> data_;
+        std::size_t capacity_{0};
+    };
+
+    template<typename CharType>
+    buffer<CharType>& get_buffer() noexcept
+    {
+        static thread_local buffer<CharType> instance;
+        return instance;
+    }
+} // namespace detail
+/// \endcond
+
+///
+/// Convert \a input to \tparam CharOut into the scratch buffer of the current thread
+///
+template<typename CharOut, typename CharIn>
+std::basic_string_view<CharOut> convert(std::basic_string_view<CharIn> input)
+{
+    // Every input char is transcoded to the output char with maximum width + trailing NULL
+    const std::size_t max_size = input.size() * utf::utf_traits<CharOut>::max_width + 1;
+    CharOut* const begin = detail::get_buffer<CharOut>().reserve(max_size);
+    CharOut* end = begin;
+    const CharIn* source = input.data();
+    const bool success = utf::convert_prefix(end, begin + max_size - 1, source, source + input.size());
+    assert(success);
+    (void)success;
+    *end = 0;
+    return {begin, static_cast<std::size_t>(end - begin)};
+}
+
+///
+/// Convert narrow string (UTF-8) to wide string (UTF-16/32) in the scratch buffer of the current thread
+///
+inline std::wstring_view widen(std::string_view s)
+{
+    return convert<wchar_t>(s);
+}
+///
+/// Convert narrow string (UTF-8) in range [begin, end) to wide string (UTF-16/32) in the scratch buffer
+/// of the current thread
+///
+inline std::wstring_view widen(const char* begin, const char* end)
+{
+    return widen(std::string_view(begin, end - begin));
+}
+
+///
+/// Convert wide string (UTF-16/32) to narrow string (UTF-8) in the scratch buffer of the current thread
+///
+inline std::string_view narrow(std::wstring_view s)
+{
+    return convert<char>(s);
+}
+///
+/// Convert wide string (UTF-16/32) in range [begin, end) to narrow string (UTF-8) in the scratch buffer
+/// of the current thread
+///
+inline std::string_view narrow(const wchar_t* begin, const wchar_t* end)
+{
+    return narrow(std::wstring_view(begin, end - begin));
+}
+
+///
+/// Return the number of characters the \tparam CharOut scratch buffer of the current thread can hold
+///
+template<typename CharOut>
+std::size_t capacity() noexcept
+{
+    return detail::get_buffer<CharOut>().capacity();
+}
+
+///
+/// Free the \tparam CharOut scratch buffer of the current thread, invalidating all views into it
+///
+template<typename CharOut>
+void release() noexcept
+{
+    detail::get_buffer<CharOut>().release();
+}
+} // namespace nowide::scratch
+
+#endif
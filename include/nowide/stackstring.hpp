@@ -9,10 +9,34 @@
 #ifndef NOWIDE_STACKSTRING_HPP_INCLUDED
 #define NOWIDE_STACKSTRING_HPP_INCLUDED
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <nowide/convert.hpp>
 #include <string_view>
+#ifdef NOWIDE_NO_HEAP_FALLBACK
+#include <cstdlib>
+#endif
+
+/// \def NOWIDE_NO_HEAP_FALLBACK
+/// Define to turn every heap fallback of the library, e.g. a basic_stackstring outgrowing its stack buffer,
+/// into a hard error by calling #NOWIDE_HEAP_FALLBACK_HANDLER instead of allocating.
+/// Use static_stackstring for conversions which must not fail this way.
+///
+/// The Windows wrappers, e.g. nowide::fopen and nowide::stat, then convert each path into a stack buffer
+/// large enough for any wide path, which costs 64 KiB of stack per path, e.g. 128 KiB for nowide::rename.
+///
+/// Must match how the library was built, as the compiled Windows wrappers and the inline functions used by
+/// them differ otherwise. Set the CMake option NOWIDE_NO_HEAP_FALLBACK, which defines it for the library and
+/// everything linking to nowide::nowide, instead of defining it in your own code.
+
+/// \def NOWIDE_HEAP_FALLBACK_HANDLER
+/// Called when a heap fallback happens while #NOWIDE_NO_HEAP_FALLBACK is defined.
+/// Must not return normally, defaults to std::abort()
+#if defined(NOWIDE_NO_HEAP_FALLBACK) && !defined(NOWIDE_HEAP_FALLBACK_HANDLER)
+#define NOWIDE_HEAP_FALLBACK_HANDLER() std::abort()
+#endif
 
 namespace nowide {
 
@@ -81,13 +105,16 @@ public:
             if(other.uses_stack_memory())
                 data_ = buffer_;
             else if(other.data_)
-                data_ = new output_char[len + 1];
-            else
+            {
+                data_ = allocate(len + 1);
+                capacity_ = len + 1;
+            } else
             {
                 data_ = nullptr;
                 return *this;
             }
             std::memcpy(data_, other.data_, sizeof(output_char) * (len + 1));
+            size_ = len;
         }
         return *this;
     }
@@ -97,16 +124,19 @@ public:
         if(this != &other)
         {
             clear();
+            const std::size_t len = other.length();
             if(other.uses_stack_memory())
             {
-                const std::size_t len = other.length();
                 data_ = buffer_;
                 std::memcpy(data_, other.data_, sizeof(output_char) * (len + 1));
             } else
             {
                 data_ = other.data_;
+                capacity_ = other.capacity_;
                 other.data_ = nullptr;
+                other.size_ = 0;
             }
+            size_ = len;
         }
         return *this;
     }
@@ -135,25 +165,73 @@ public:
 
         if(begin)
         {
-            const std::size_t input_len = end - begin;
-            // Minimum size required: 1 output char per input char + trailing NULL
-            const std::size_t min_output_size = input_len + 1;
-            // If there is a chance the converted string fits on stack, try it
-            if(min_output_size <= buffer_size && utf::convert_buffer(buffer_, buffer_size, begin, end))
-                data_ = buffer_;
-            else
-            {
-                // Fallback: Allocate a buffer that is surely large enough on heap
-                // Max size: Every input char is transcoded to the output char with maximum with + trailing NULL
-                const std::size_t max_output_size = input_len * utf::utf_traits<output_char>::max_width + 1;
-                data_ = new output_char[max_output_size];
-                const bool success = utf::convert_buffer(data_, max_output_size, begin, end) == data_;
-                assert(success);
-                (void)success;
-            }
+            data_ = buffer_;
+            buffer_[0] = 0;
+            append(begin, end);
         }
         return data();
     }
+
+    /// Convert the NULL terminated string input and append it to the current string
+    /// Appending to a NULL stackstring starts a new string, a NULL input is ignored
+    output_char* append(const input_char* input)
+    {
+        return append(input ? std::basic_string_view<input_char>(input) : std::basic_string_view<input_char>());
+    }
+    /// Convert the string input and append it to the current string
+    /// Appending to a NULL stackstring starts a new string
+    output_char* append(std::basic_string_view<input_char> input)
+    {
+        return append(input.data(), input.data() + input.length());
+    }
+    /// Convert the sequence [begin, end) and append it to the current string
+    ///
+    /// Only the new input is converted, the existing content is kept as-is and moved to the heap only
+    /// if the buffer gets too small.
+    /// Appending to a NULL stackstring starts a new string, a NULL begin is ignored
+    output_char* append(const input_char* begin, const input_char* end)
+    {
+        if(!begin)
+            return data();
+        if(!data_)
+        {
+            data_ = buffer_;
+            size_ = 0;
+        }
+        output_char* out = data_ + size_;
+        if(!utf::convert_prefix(out, data_ + capacity() - 1, begin, end))
+        {
+            // Fallback: Move to a heap buffer that is surely large enough for the remaining input
+            // Max size: Every input char is transcoded to the output char with maximum width + trailing NULL
+            // Grow at least geometrically so repeated appends don't copy the prefix each time
+            const std::size_t converted_size = out - data_;
+            const std::size_t new_capacity =
+              std::max(converted_size + (end - begin) * utf::utf_traits<output_char>::max_width + 1, 2 * capacity());
+            output_char* new_data = allocate(new_capacity);
+            std::memcpy(new_data, data_, sizeof(output_char) * converted_size);
+            if(!uses_stack_memory())
+                delete[] data_;
+            data_ = new_data;
+            capacity_ = new_capacity;
+            out = data_ + converted_size;
+            const bool success = utf::convert_prefix(out, data_ + capacity_ - 1, begin, end);
+            assert(success);
+            (void)success;
+        }
+        *out = 0;
+        size_ = out - data_;
+        return data();
+    }
+    /// Shorten the string to \a new_length characters, e.g. to a length saved before an append
+    /// Does nothing if the string is not longer than \a new_length
+    void truncate(std::size_t new_length) noexcept
+    {
+        if(new_length < size_)
+        {
+            size_ = new_length;
+            data_[size_] = 0;
+        }
+    }
     /// Return the converted, NULL-terminated string or NULL if no string was converted
     constexpr output_char* data() noexcept
     {
@@ -175,6 +253,7 @@ public:
         if(!uses_stack_memory())
             delete[] data_;
         data_ = nullptr;
+        size_ = 0;
     }
     /// Swap lhs with rhs
     friend void swap(basic_stackstring& lhs, basic_stackstring& rhs) noexcept
@@ -197,6 +276,8 @@ public:
             std::swap(lhs.buffer_, rhs.buffer_);
         } else
             std::swap(lhs.data_, rhs.data_);
+        std::swap(lhs.size_, rhs.size_);
+        std::swap(lhs.capacity_, rhs.capacity_);
     }
 
     /// Converts to std::basic_string_view
@@ -205,7 +286,7 @@ public:
         if(!data_)
             return {};
         else
-            return data_;
+            return {data_, size_};
     }
 
     /// Return the reference of character of the specified index
@@ -223,10 +304,7 @@ public:
     /// If NULL is stored returns 0
     constexpr std::size_t length() const noexcept
     {
-        if(!data_)
-            return 0;
-        else
-            return std::char_traits<output_char>::length(data_);
+        return size_;
     }
 
     /// Same as length()
@@ -238,10 +316,7 @@ public:
     /// Return whether the string is empty
     constexpr bool empty() const noexcept
     {
-        if(!data_)
-            return true;
-        else
-            return !data_[0];
+        return size_ == 0;
     }
 
 protected:
@@ -252,8 +327,25 @@ protected:
     }
 
 private:
+    /// Number of characters the current buffer can hold including the NULL terminator
+    constexpr std::size_t capacity() const noexcept
+    {
+        return uses_stack_memory() ? buffer_size : capacity_;
+    }
+    static output_char* allocate(std::size_t size)
+    {
+#ifdef NOWIDE_NO_HEAP_FALLBACK
+        NOWIDE_HEAP_FALLBACK_HANDLER();
+#endif
+        return new output_char[size];
+    }
+
     output_char buffer_[buffer_size];
     output_char* data_{nullptr};
+    /// Length of the string excluding the NULL terminator
+    std::size_t size_{0};
+    /// Size of the heap buffer, unused if the stack buffer is used
+    std::size_t capacity_{0};
 }; // basic_stackstring
 
 ///
@@ -273,6 +365,203 @@ using wshort_stackstring = basic_stackstring<wchar_t, char, 16>;
 ///
 using short_stackstring = basic_stackstring<char, wchar_t, 16>;
 
+///
+/// \brief What static_stackstring does if the converted string does not fit into its buffer
+///
+enum class overflow_policy
+{
+    /// The conversion fails and the result is NULL
+    fail,
+    /// The result is cut after the last complete code point that fits
+    truncate
+};
+
+///
+/// \brief A class that allows to create a temporary wide or narrow UTF string from
+/// wide or narrow UTF source in a fixed size buffer.
+///
+/// Unlike basic_stackstring it never allocates, so it can be used in contexts that must not touch the heap.
+/// If the converted string does not fit into the buffer, the result depends on the overflow_policy:
+/// Either the conversion fails and NULL is returned or the string is truncated at a code point boundary.
+/// In both cases overflow() returns true.
+///
+/// Invalid UTF characters are replaced by the substitution character, see #NOWIDE_REPLACEMENT_CHARACTER
+///
+/// If a NULL pointer is passed to the constructor or convert method, NULL will be returned by c_str.
+/// Similarily a default constructed static_stackstring will return NULL on calling c_str.
+///
+template<typename CharOut = wchar_t, typename CharIn = char, std::size_t BufferSize = 256>
+class static_stackstring
+{
+    static_assert(BufferSize > 0, "A static_stackstring needs room for at least the NULL terminator");
+
+public:
+    /// Size of the buffer including the NULL terminator
+    static constexpr std::size_t buffer_size = BufferSize;
+    /// Type of the output character (converted to)
+    using output_char = CharOut;
+    /// Type of the input character (converted from)
+    using input_char = CharIn;
+
+    /// Creates a NULL static_stackstring
+    constexpr static_stackstring() noexcept
+    {
+        buffer_[0] = 0;
+    }
+    /// Convert the NULL terminated string input and store in internal buffer
+    /// If input is NULL, nothing will be stored
+    explicit static_stackstring(const input_char* input, overflow_policy policy = overflow_policy::fail) noexcept
+    {
+        convert(input, policy);
+    }
+    /// Convert the string input and store in internal buffer
+    explicit static_stackstring(std::basic_string_view<input_char> input,
+                                overflow_policy policy = overflow_policy::fail) noexcept
+    {
+        convert(input, policy);
+    }
+    /// Convert the sequence [begin, end) and store in internal buffer
+    /// If begin is NULL, nothing will be stored
+    static_stackstring(const input_char* begin,
+                       const input_char* end,
+                       overflow_policy policy = overflow_policy::fail) noexcept
+    {
+        convert(begin, end, policy);
+    }
+
+    /// Convert the NULL terminated string input and store in internal buffer
+    /// If input is NULL, the current buffer will be reset to NULL
+    /// \return the converted string or NULL on overflow with overflow_policy::fail
+    output_char* convert(const input_char* input, overflow_policy policy = overflow_policy::fail) noexcept
+    {
+        if(!input)
+            return convert(nullptr, nullptr, policy);
+        const std::basic_string_view<input_char> view(input);
+        return convert(view.data(), view.data() + view.length(), policy);
+    }
+    /// Convert the string input and store in internal buffer
+    /// \return the converted string or NULL on overflow with overflow_policy::fail
+    output_char* convert(std::basic_string_view<input_char> input,
+                         overflow_policy policy = overflow_policy::fail) noexcept
+    {
+        return convert(input.data(), input.data() + input.length(), policy);
+    }
+    /// Convert the sequence [begin, end) and store in internal buffer
+    /// If begin is NULL, the current buffer will be reset to NULL
+    /// \return the converted string or NULL on overflow with overflow_policy::fail
+    output_char* convert(const input_char* begin,
+                         const input_char* end,
+                         overflow_policy policy = overflow_policy::fail) noexcept
+    {
+        clear();
+        if(begin)
+        {
+            output_char* out = buffer_;
+            overflow_ = !utf::convert_prefix(out, buffer_ + buffer_size - 1, begin, end);
+            *out = 0;
+            size_ = out - buffer_;
+            is_null_ = overflow_ && policy == overflow_policy::fail;
+        }
+        return data();
+    }
+    /// Return the converted, NULL-terminated string or NULL if no string was converted
+    constexpr output_char* data() noexcept
+    {
+        return is_null_ ? nullptr : buffer_;
+    }
+    /// Return the converted, NULL-terminated string or NULL if no string was converted
+    constexpr const output_char* data() const noexcept
+    {
+        return is_null_ ? nullptr : buffer_;
+    }
+    /// Return the converted, NULL-terminated string or NULL if no string was converted
+    constexpr const output_char* c_str() const noexcept
+    {
+        return data();
+    }
+    /// Return true if the last conversion did not fit into the buffer, i.e. it failed or was truncated
+    constexpr bool overflow() const noexcept
+    {
+        return overflow_;
+    }
+    /// Reset the internal buffer to NULL
+    constexpr void clear() noexcept
+    {
+        buffer_[0] = 0;
+        size_ = 0;
+        is_null_ = true;
+        overflow_ = false;
+    }
+
+    /// Converts to std::basic_string_view
+    constexpr operator std::basic_string_view<output_char>() const noexcept
+    {
+        if(is_null_)
+            return {};
+        else
+            return {buffer_, size_};
+    }
+
+    /// Return the reference of character of the specified index
+    constexpr output_char& operator[](std::size_t index) noexcept
+    {
+        return buffer_[index];
+    }
+    /// Return the reference of character of the specified index
+    constexpr const output_char& operator[](std::size_t index) const noexcept
+    {
+        return buffer_[index];
+    }
+
+    /// Return the current length of the string excluding the NULL terminator
+    /// If NULL is stored returns 0
+    constexpr std::size_t length() const noexcept
+    {
+        return is_null_ ? 0 : size_;
+    }
+
+    /// Same as length()
+    constexpr std::size_t size() const noexcept
+    {
+        return length();
+    }
+
+    /// Return whether the string is empty
+    constexpr bool empty() const noexcept
+    {
+        return length() == 0;
+    }
+
+private:
+    output_char buffer_[buffer_size];
+    std::size_t size_{0};
+    bool is_null_{true};
+    bool overflow_{false};
+}; // static_stackstring
+
+/// \cond INTERNAL
+namespace detail {
+#ifdef NOWIDE_NO_HEAP_FALLBACK
+    /// Used by the Windows wrappers to convert paths, large enough for any path the wide API accepts.
+    /// Takes 64 KiB of stack.
+    using wpath_stackstring = static_stackstring<wchar_t, char, 32768>;
+#else
+    /// Used by the Windows wrappers to convert paths
+    using wpath_stackstring = wstackstring;
+#endif
+    /// Return true and set errno if the non-NULL \a name did not fit into \a wname
+    inline bool is_name_too_long(const char* name, const wpath_stackstring& wname) noexcept
+    {
+        if(name && !wname.data())
+        {
+            errno = ENAMETOOLONG;
+            return true;
+        }
+        return false;
+    }
+} // namespace detail
+/// \endcond
+
 } // namespace nowide
 
 #endif
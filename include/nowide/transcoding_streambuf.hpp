@@ -0,0 +1,196 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_TRANSCODING_STREAMBUF_HPP_INCLUDED
+#define NOWIDE_TRANSCODING_STREAMBUF_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <nowide/utf/convert.hpp>
+#include <streambuf>
+
+namespace nowide {
+///
+/// \brief Stream buffer presenting UTF-16/32 (or validated UTF-8) on top of a stream buffer of UTF-8 bytes
+///
+/// This is a replacement for std::wbuffer_convert with nowide::utf8_codecvt. Any std::streambuf, e.g. a
+/// nowide::filebuf, a pipe or a std::stringbuf, can be wrapped. Input and output are converted in blocks of
+/// \a block_size characters without going through the virtual codecvt interface.
+/// A sequence split between two blocks is carried over to the next block.
+///
+/// If crlf() is enabled, the bytes use CR LF line endings like text files on Windows: CR LF is read as LF
+/// and LF is written as CR LF. This is done in the same pass as the conversion.
+///
+/// Invalid sequences and an incomplete sequence at the end of the input or output are replaced
+/// by #NOWIDE_REPLACEMENT_CHARACTER. Seeking is not supported.
+///
+/// The wrapped stream buffer is not owned. Pending output is written when the stream buffer is synced or destroyed.
+///
+/// The bytes are UTF-8 unless \tparam ByteChar is a single byte encoding like utf::latin1_char.
+///
+template<typename CharOut = wchar_t, typename ByteChar = char>
+class transcoding_streambuf : public std::basic_streambuf<CharOut>
+{
+    using base_type = std::basic_streambuf<CharOut>;
+
+public:
+    using typename base_type::char_type;
+    using typename base_type::int_type;
+    using typename base_type::traits_type;
+
+    /// Smallest supported block size, smaller values are rounded up
+    static constexpr std::size_t min_block_size = 16;
+
+    /// Create a stream buffer converting to and from \a bytebuf in blocks of \a block_size characters
+    explicit transcoding_streambuf(std::streambuf* bytebuf = nullptr, std::size_t block_size = 4096) :
+        rdbuf_(bytebuf), block_size_(std::max(block_size, min_block_size))
+    {}
+    transcoding_streambuf(const transcoding_streambuf&) = delete;
+    transcoding_streambuf& operator=(const transcoding_streambuf&) = delete;
+    ~transcoding_streambuf() override
+    {
+        if(rdbuf_ && this->pbase())
+            flush_output(true);
+    }
+
+    /// Return the wrapped stream buffer
+    std::streambuf* rdbuf() const noexcept
+    {
+        return rdbuf_;
+    }
+    /// Wrap \a bytebuf instead of the current stream buffer and return the previous one
+    std::streambuf* rdbuf(std::streambuf* bytebuf) noexcept
+    {
+        std::streambuf* const result = rdbuf_;
+        rdbuf_ = bytebuf;
+        return result;
+    }
+    /// Return the number of characters converted at once
+    std::size_t block_size() const noexcept
+    {
+        return block_size_;
+    }
+    /// Return true if CR LF line endings are converted, the default is false
+    bool crlf() const noexcept
+    {
+        return crlf_;
+    }
+    /// Enable or disable the conversion of CR LF line endings
+    void crlf(bool enable) noexcept
+    {
+        crlf_ = enable;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if(this->gptr() != this->egptr())
+            return traits_type::to_int_type(*this->gptr());
+        if(!rdbuf_)
+            return traits_type::eof();
+        if(!in_bytes_)
+        {
+            in_bytes_.reset(new char[block_size_]);
+            in_chars_.reset(new char_type[block_size_]);
+        }
+        for(;;)
+        {
+            const std::streamsize count =
+              rdbuf_->sgetn(in_bytes_.get() + in_carry_, static_cast<std::streamsize>(block_size_ - in_carry_));
+            const bool at_eof = count <= 0;
+            if(at_eof && !in_carry_)
+                return traits_type::eof();
+            const ByteChar* from = reinterpret_cast<const ByteChar*>(in_bytes_.get());
+            const ByteChar* const bytes_end = from + in_carry_ + std::max<std::streamsize>(count, 0);
+            const utf::newline_conversion newlines =
+              crlf_ ? utf::newline_conversion::crlf_to_lf : utf::newline_conversion::none;
+            // An incomplete sequence at the end may be completed by the next block unless this is the end of input
+            const ByteChar* const from_end =
+              at_eof ? bytes_end : utf::complete_sequences_end(from, bytes_end, newlines);
+            char_type* to = in_chars_.get();
+            utf::convert_prefix(to, to + block_size_, from, from_end, newlines);
+            // Carry over everything not converted
+            in_carry_ = bytes_end - from;
+            std::memmove(in_bytes_.get(), from, in_carry_);
+            if(to != in_chars_.get())
+            {
+                this->setg(in_chars_.get(), in_chars_.get(), to);
+                return traits_type::to_int_type(*this->gptr());
+            }
+        }
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if(!rdbuf_)
+            return traits_type::eof();
+        if(!out_chars_)
+        {
+            out_chars_.reset(new char_type[block_size_]);
+            out_bytes_.reset(new char[block_size_]);
+            this->setp(out_chars_.get(), out_chars_.get() + block_size_);
+        } else if(!flush_output(false))
+            return traits_type::eof();
+        if(traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        *this->pptr() = traits_type::to_char_type(c);
+        this->pbump(1);
+        return c;
+    }
+
+    int sync() override
+    {
+        if(!rdbuf_)
+            return -1;
+        if(this->pbase() && !flush_output(false))
+            return -1;
+        return rdbuf_->pubsync();
+    }
+
+private:
+    /// Convert and write the put area, keeping an incomplete sequence at its end unless \a final is true
+    bool flush_output(bool final)
+    {
+        const char_type* from = this->pbase();
+        const char_type* const from_end = final ? this->pptr() : utf::complete_sequences_end(from, this->pptr());
+        const utf::newline_conversion newlines =
+          crlf_ ? utf::newline_conversion::lf_to_crlf : utf::newline_conversion::none;
+        while(from != from_end)
+        {
+            ByteChar* const bytes = reinterpret_cast<ByteChar*>(out_bytes_.get());
+            ByteChar* to = bytes;
+            utf::convert_prefix(to, to + block_size_, from, from_end, newlines);
+            const std::streamsize count = to - bytes;
+            if(rdbuf_->sputn(out_bytes_.get(), count) != count)
+                return false;
+        }
+        const std::ptrdiff_t carry = this->pptr() - from;
+        traits_type::move(out_chars_.get(), from, static_cast<std::size_t>(carry));
+        this->setp(out_chars_.get(), out_chars_.get() + block_size_);
+        this->pbump(static_cast<int>(carry));
+        return true;
+    }
+
+    std::streambuf* rdbuf_;
+    std::size_t block_size_;
+    bool crlf_{false};
+    std::unique_ptr<char[]> in_bytes_;
+    std::unique_ptr<char_type[]> in_chars_;
+    std::size_t in_carry_{0};
+    std::unique_ptr<char_type[]> out_chars_;
+    std::unique_ptr<char[]> out_bytes_;
+}; // transcoding_streambuf
+
+///
+/// Convenience typedef
+///
+using wtranscoding_streambuf = transcoding_streambuf<wchar_t>;
+
+} // namespace nowide
+
+#endif
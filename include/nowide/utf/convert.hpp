@@ -9,12 +9,207 @@
 #ifndef NOWIDE_DETAIL_CONVERT_HPP_INCLUDED
 #define NOWIDE_DETAIL_CONVERT_HPP_INCLUDED
 
+#include <algorithm>
 #include <iterator>
 #include <nowide/replacement.hpp>
+#include <nowide/utf/simd.hpp>
 #include <nowide/utf/utf.hpp>
 #include <string>
 
 namespace nowide::utf {
+///
+/// \brief Conversion of line endings done together with the conversion of the encoding
+///
+enum class newline_conversion
+{
+    /// Line endings are kept
+    none,
+    /// CR LF is replaced by LF, a lone CR is kept
+    crlf_to_lf,
+    /// LF is replaced by CR LF
+    lf_to_crlf
+};
+
+/// \cond INTERNAL
+namespace detail {
+    template<typename CharType>
+    constexpr bool is_latin1() noexcept
+    {
+        if constexpr(is_single_byte_char<CharType>::value)
+            return CharType::table_type::is_latin1;
+        else
+            return false;
+    }
+
+    template<newline_conversion Newlines, typename CharOut, typename CharIn>
+    bool convert_prefix(CharOut*& buffer,
+                        CharOut* buffer_end,
+                        const CharIn*& source_begin,
+                        const CharIn* source_end) noexcept
+    {
+        // The character at which the ASCII block copy has to stop
+        constexpr int stop = Newlines == newline_conversion::crlf_to_lf
+                               ? '\r'
+                               : (Newlines == newline_conversion::lf_to_crlf ? '\n' : -1);
+        constexpr bool to_utf16_32 = sizeof(CharOut) > 1 && simd::is_supported_unit<CharOut>;
+        if constexpr(Newlines == newline_conversion::none && is_single_byte_char<CharIn>::value && to_utf16_32)
+        {
+            // Each byte is one BMP code point and so one UTF-16/32 code unit
+            const std::size_t count = std::min<std::size_t>(source_end - source_begin, buffer_end - buffer);
+            if constexpr(is_latin1<CharIn>())
+            {
+                buffer = simd::copy_ascii(source_begin, count, buffer);
+                source_begin += count;
+            } else
+            {
+                for(std::size_t i = 0; i < count; i++)
+                    *buffer++ = static_cast<CharOut>(utf_traits<CharIn>::decode_valid(source_begin));
+            }
+            return source_begin == source_end;
+        }
+        while(source_begin != source_end)
+        {
+            if constexpr(Newlines == newline_conversion::none && is_latin1<CharIn>() && sizeof(CharOut) == 1
+                         && !is_single_byte_char<CharOut>::value)
+            {
+                // Expand to 2 bytes at most without checking the room for each character
+                const std::size_t count = std::min<std::size_t>(source_end - source_begin, (buffer_end - buffer) / 2);
+                if(count)
+                {
+                    buffer = simd::latin1_to_utf8(source_begin, count, buffer);
+                    source_begin += count;
+                    continue;
+                }
+            }
+            if constexpr(Newlines == newline_conversion::none && is_latin1<CharOut>() && sizeof(CharIn) > 1
+                         && simd::is_supported_unit<CharIn>)
+            {
+                // Narrow runs below 0x100 as a block
+                const std::size_t max_count = std::min<std::size_t>(source_end - source_begin, buffer_end - buffer);
+                const std::size_t count = simd::latin1_length(source_begin, source_begin + max_count);
+                if(count)
+                {
+                    buffer = simd::copy_ascii(source_begin, count, buffer);
+                    source_begin += count;
+                    continue;
+                }
+            }
+            if constexpr(simd::is_supported_unit<CharIn> && simd::is_supported_unit<CharOut>)
+            {
+                // Copy runs of ASCII as a block
+                if(static_cast<std::uint32_t>(*source_begin) < 0x80)
+                {
+                    const std::size_t max_count =
+                      std::min<std::size_t>(source_end - source_begin, buffer_end - buffer);
+                    const std::size_t count = simd::ascii_length<stop>(source_begin, source_begin + max_count);
+                    if(count)
+                    {
+                        buffer = simd::copy_ascii(source_begin, count, buffer);
+                        source_begin += count;
+                        continue;
+                    }
+                }
+            }
+            if constexpr(Newlines == newline_conversion::crlf_to_lf)
+            {
+                // Drop the CR, the LF is copied next
+                if(static_cast<std::uint32_t>(*source_begin) == '\r' && source_end - source_begin >= 2
+                   && static_cast<std::uint32_t>(source_begin[1]) == '\n')
+                {
+                    ++source_begin;
+                    continue;
+                }
+            } else if constexpr(Newlines == newline_conversion::lf_to_crlf)
+            {
+                if(static_cast<std::uint32_t>(*source_begin) == '\n')
+                {
+                    NOWIDE_UNLIKELY_IF(buffer_end - buffer < 2)
+                        return false;
+                    *buffer++ = static_cast<CharOut>('\r');
+                    *buffer++ = static_cast<CharOut>('\n');
+                    ++source_begin;
+                    continue;
+                }
+            }
+            const CharIn* const code_begin = source_begin;
+            code_point c = utf_traits<CharIn>::decode(source_begin, source_end);
+            if(c == illegal || c == incomplete)
+            {
+                c = NOWIDE_REPLACEMENT_CHARACTER;
+            }
+            NOWIDE_UNLIKELY_IF(buffer_end - buffer < utf_traits<CharOut>::width(c))
+            {
+                source_begin = code_begin;
+                return false;
+            }
+            buffer = utf_traits<CharOut>::encode(c, buffer);
+        }
+        return true;
+    }
+} // namespace detail
+/// \endcond
+
+///
+/// Convert the UTF sequences in range [source_begin, source_end) from \tparam CharIn to \tparam CharOut
+/// into the output range [buffer, buffer_end) without NULL terminating it.
+///
+/// Conversion stops before the first code point that does not fit into the output, so the output always
+/// ends at a code point boundary. \a buffer and \a source_begin are advanced past the written output and
+/// consumed input.
+///
+/// Line endings are converted according to \a newlines in the same pass.
+///
+/// \return true if the whole input was converted, false if the output was too small
+///
+/// Any illegal sequences are replaced with the replacement character, see #NOWIDE_REPLACEMENT_CHARACTER
+///
+template<typename CharOut, typename CharIn>
+bool convert_prefix(CharOut*& buffer,
+                    CharOut* buffer_end,
+                    const CharIn*& source_begin,
+                    const CharIn* source_end,
+                    newline_conversion newlines = newline_conversion::none) noexcept
+{
+    switch(newlines)
+    {
+    case newline_conversion::none: break;
+    case newline_conversion::crlf_to_lf:
+        return detail::convert_prefix<newline_conversion::crlf_to_lf>(buffer, buffer_end, source_begin, source_end);
+    case newline_conversion::lf_to_crlf:
+        return detail::convert_prefix<newline_conversion::lf_to_crlf>(buffer, buffer_end, source_begin, source_end);
+    }
+    return detail::convert_prefix<newline_conversion::none>(buffer, buffer_end, source_begin, source_end);
+}
+
+///
+/// Return the end of the range [begin, end) excluding a trailing UTF sequence which is cut short by \a end
+///
+/// Such a sequence might be completed by more input, so when converting input block by block
+/// it has to be carried over to the next block instead of being replaced.
+/// For newline_conversion::crlf_to_lf a trailing CR is excluded too, as it might be followed by a LF.
+///
+template<typename CharType>
+const CharType* complete_sequences_end(const CharType* begin,
+                                       const CharType* end,
+                                       newline_conversion newlines = newline_conversion::none) noexcept
+{
+    using traits = utf_traits<CharType>;
+    const CharType* result = end;
+    for(std::ptrdiff_t i = 1; i < traits::max_width && i <= end - begin; i++)
+    {
+        const CharType c = end[-i];
+        if(traits::is_trail(c))
+            continue;
+        if(traits::trail_length(c) >= i)
+            result = end - i;
+        break;
+    }
+    if(newlines == newline_conversion::crlf_to_lf && result != begin
+       && static_cast<std::uint32_t>(result[-1]) == '\r')
+        --result;
+    return result;
+}
+
 ///
 /// Convert a buffer of UTF sequences in the range [source_begin, source_end)
 /// from \tparam CharIn to \tparam CharOut to the output \a buffer of size \a buffer_size.
@@ -30,26 +225,10 @@ convert_buffer(CharOut* buffer, size_t buffer_size, const CharIn* source_begin,
 {
     if(!buffer_size)
         return nullptr;
-    CharOut* rv = buffer;
-    buffer_size--;
-    while(source_begin != source_end)
-    {
-        code_point c = utf_traits<CharIn>::decode(source_begin, source_end);
-        if(c == illegal || c == incomplete)
-        {
-            c = NOWIDE_REPLACEMENT_CHARACTER;
-        }
-        size_t width = utf_traits<CharOut>::width(c);
-        if(buffer_size < width)
-        {
-            rv = nullptr;
-            break;
-        }
-        buffer = utf_traits<CharOut>::encode(c, buffer);
-        buffer_size -= width;
-    }
-    *buffer++ = 0;
-    return rv;
+    CharOut* out = buffer;
+    const bool complete = convert_prefix(out, buffer + buffer_size - 1, source_begin, source_end);
+    *out = 0;
+    return complete ? buffer : nullptr;
 }
 
 ///
@@ -0,0 +1,74 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_UTF_ENDIAN_HPP_INCLUDED
+#define NOWIDE_UTF_ENDIAN_HPP_INCLUDED
+
+#include <cstddef>
+#include <nowide/config.hpp>
+#include <type_traits>
+
+namespace nowide::utf {
+///
+/// \brief A code unit stored with an explicit byte order, e.g. one of UTF-16BE
+///
+/// It converts implicitly from and to \tparam UnitType, so it can be used as the character type of
+/// utf_traits and all conversion functions, e.g. `utf::convert_string<char>(be16_begin, be16_end)`.
+/// As its alignment is 1, any byte buffer can be accessed as an array of it.
+///
+template<typename UnitType, bool BigEndian>
+class endian_unit
+{
+public:
+    /// The integral code unit type in native byte order
+    using value_type = UnitType;
+    /// True if the bytes are stored in reverse of the native byte order
+#ifdef NOWIDE_BIG_ENDIAN
+    static constexpr bool swapped = !BigEndian;
+#else
+    static constexpr bool swapped = BigEndian;
+#endif
+
+    endian_unit() = default;
+    constexpr endian_unit(value_type value) noexcept : bytes_{}
+    {
+        for(std::size_t i = 0; i < sizeof(value_type); i++)
+            bytes_[BigEndian ? sizeof(value_type) - 1 - i : i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+    constexpr operator value_type() const noexcept
+    {
+        value_type result = 0;
+        for(std::size_t i = 0; i < sizeof(value_type); i++)
+            result |= static_cast<value_type>(bytes_[BigEndian ? sizeof(value_type) - 1 - i : i]) << (8 * i);
+        return result;
+    }
+
+private:
+    unsigned char bytes_[sizeof(value_type)];
+};
+
+/// UTF-16 code unit in big endian byte order
+using be16 = endian_unit<char16_t, true>;
+/// UTF-16 code unit in little endian byte order
+using le16 = endian_unit<char16_t, false>;
+/// UTF-32 code unit in big endian byte order
+using be32 = endian_unit<char32_t, true>;
+/// UTF-32 code unit in little endian byte order
+using le32 = endian_unit<char32_t, false>;
+
+///
+/// True if \tparam CharType is an endian_unit
+///
+template<typename CharType>
+struct is_endian_unit : std::false_type
+{};
+template<typename UnitType, bool BigEndian>
+struct is_endian_unit<endian_unit<UnitType, BigEndian>> : std::true_type
+{};
+} // namespace nowide::utf
+
+#endif
@@ -0,0 +1,472 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_UTF_SIMD_HPP_INCLUDED
+#define NOWIDE_UTF_SIMD_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <nowide/config.hpp>
+#include <nowide/utf/endian.hpp>
+#include <nowide/utf/single_byte.hpp>
+#include <type_traits>
+
+/// \def NOWIDE_NO_SIMD
+/// Define to disable the use of SIMD intrinsics, the portable word-at-a-time kernels are used instead
+
+//! @cond Doxygen_Suppress
+#if !defined(NOWIDE_NO_SIMD) \
+  && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NOWIDE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(NOWIDE_MSVC) && !defined(NOWIDE_CLANG)
+#include <intrin.h>
+#endif
+//! @endcond
+
+///
+/// \brief Block kernels working on many code units at once
+///
+/// They are used by the conversion functions for the common runs of simple text, e.g. ASCII,
+/// while the per code point functions in utf_traits handle everything else.
+/// SSE2 is used where available, otherwise 64 bit words are processed at once.
+///
+namespace nowide::utf::simd {
+///
+/// \brief True if \tparam CharType stores code units as plain integers in native byte order
+///
+template<typename CharType>
+constexpr bool is_native_unit = std::is_integral_v<CharType>
+                                && (sizeof(CharType) == 1 || sizeof(CharType) == 2 || sizeof(CharType) == 4);
+
+///
+/// \brief True if \tparam CharType can be processed by the kernels in this namespace
+///
+/// Those are native code units, endian_unit, whose byte swapping is done within the kernels,
+/// and single_byte_char, whose ASCII characters are the same as those of UTF-8.
+///
+template<typename CharType>
+constexpr bool is_supported_unit =
+  is_native_unit<CharType> || is_endian_unit<CharType>::value || is_single_byte_char<CharType>::value;
+
+/// \cond INTERNAL
+namespace detail {
+    inline unsigned count_trailing_zeros(std::uint32_t value) noexcept
+    {
+#if defined(NOWIDE_GCC) || defined(NOWIDE_CLANG)
+        return static_cast<unsigned>(__builtin_ctz(value));
+#elif defined(NOWIDE_MSVC)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        unsigned result = 0;
+        while(!(value & 1u))
+        {
+            value >>= 1;
+            result++;
+        }
+        return result;
+#endif
+    }
+
+    inline unsigned popcount(std::uint32_t value) noexcept
+    {
+#if defined(NOWIDE_GCC) || defined(NOWIDE_CLANG)
+        return static_cast<unsigned>(__builtin_popcount(value));
+#else
+        value = value - ((value >> 1) & 0x55555555u);
+        value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+        return static_cast<unsigned>((((value + (value >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+    }
+
+    inline std::uint64_t load64(const void* p) noexcept
+    {
+        std::uint64_t result;
+        std::memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    /// True if the bytes of \tparam CharType are in reverse of the native byte order
+    template<typename CharType, bool = is_endian_unit<CharType>::value>
+    constexpr bool is_swapped = false;
+    template<typename CharType>
+    constexpr bool is_swapped<CharType, true> = CharType::swapped;
+
+    /// Bits which are set in any non-ASCII code unit of the given size replicated over 64 bits
+    template<std::size_t Size, bool Swapped = false>
+    constexpr std::uint64_t non_ascii_bits =
+      Size == 1 ? 0x8080808080808080u
+                : (Size == 2 ? (Swapped ? 0x80FF80FF80FF80FFu : 0xFF80FF80FF80FF80u)
+                             : (Swapped ? 0x80FFFFFF80FFFFFFu : 0xFFFFFF80FFFFFF80u));
+
+    /// Bits which are set in any UTF-16/32 code unit above 0xFF of the given size replicated over 64 bits
+    template<std::size_t Size, bool Swapped = false>
+    constexpr std::uint64_t non_latin1_bits = Size == 2 ? (Swapped ? 0x00FF00FF00FF00FFu : 0xFF00FF00FF00FF00u)
+                                                        : (Swapped ? 0x00FFFFFF00FFFFFFu : 0xFFFFFF00FFFFFF00u);
+
+    /// Bits which are set in the lowest bit of each code unit of the given size replicated over 64 bits
+    template<std::size_t Size>
+    constexpr std::uint64_t lowest_bits = Size == 1 ? 0x0101010101010101u
+                                                    : (Size == 2 ? 0x0001000100010001u : 0x0000000100000001u);
+
+    /// True if any of the code units of the given size in \a word is zero
+    template<std::size_t Size>
+    constexpr bool has_zero_unit(std::uint64_t word) noexcept
+    {
+        constexpr std::uint64_t highest_bits = lowest_bits<Size> << (8 * Size - 1);
+        return ((word - lowest_bits<Size>) & ~word & highest_bits) != 0;
+    }
+
+    template<typename CharType>
+    constexpr bool is_ascii(CharType c) noexcept
+    {
+        return (static_cast<std::uint32_t>(c) & static_cast<std::uint32_t>(non_ascii_bits<sizeof(CharType)>)) == 0;
+    }
+
+#ifdef NOWIDE_SIMD_SSE2
+    /// Convert a vector of code units \tparam CharType from or to the native byte order
+    template<typename CharType>
+    __m128i to_native(__m128i v) noexcept
+    {
+        if constexpr(is_swapped<CharType>)
+        {
+            if constexpr(sizeof(CharType) == 4)
+            {
+                // Swap the 16 bit halves, then the bytes within them
+                v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+            }
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        }
+        return v;
+    }
+
+    /// Shift the bytes of \a current up by \a Count, filling in the last bytes of \a previous
+    template<int Count>
+    __m128i shift_in(__m128i current, __m128i previous) noexcept
+    {
+        return _mm_or_si128(_mm_slli_si128(current, Count), _mm_srli_si128(previous, 16 - Count));
+    }
+#endif
+} // namespace detail
+/// \endcond
+
+///
+/// Return the number of leading ASCII code units in [begin, end)
+///
+/// If \tparam Stop is an ASCII character, the count also ends before its first occurrence.
+///
+template<int Stop = -1, typename CharType>
+std::size_t ascii_length(const CharType* begin, const CharType* end) noexcept
+{
+    static_assert(is_supported_unit<CharType>, "Unsupported code unit type");
+    static_assert(Stop < 0x80, "Only ASCII characters can be searched");
+    constexpr std::ptrdiff_t unit_size = sizeof(CharType);
+    const CharType* p = begin;
+#ifdef NOWIDE_SIMD_SSE2
+    constexpr std::ptrdiff_t units_per_vector = 16 / unit_size;
+    const __m128i zero = _mm_setzero_si128();
+    while(end - p >= units_per_vector)
+    {
+        const __m128i v = detail::to_native<CharType>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        unsigned mask;
+        if constexpr(unit_size == 1)
+        {
+            mask = static_cast<unsigned>(_mm_movemask_epi8(v));
+            if constexpr(Stop >= 0)
+                mask |= static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(Stop))));
+        } else if constexpr(unit_size == 2)
+        {
+            const __m128i high_bits = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFF80)));
+            mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(high_bits, zero))) & 0xFFFFu;
+            if constexpr(Stop >= 0)
+                mask |= static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_set1_epi16(Stop))));
+        } else
+        {
+            const __m128i high_bits = _mm_and_si128(v, _mm_set1_epi32(static_cast<int>(0xFFFFFF80)));
+            mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi32(high_bits, zero))) & 0xFFFFu;
+            if constexpr(Stop >= 0)
+                mask |= static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi32(v, _mm_set1_epi32(Stop))));
+        }
+        if(mask)
+            return (p - begin) + detail::count_trailing_zeros(mask) / unit_size;
+        p += units_per_vector;
+    }
+#endif
+    constexpr std::ptrdiff_t units_per_word = 8 / unit_size;
+    constexpr bool swapped = detail::is_swapped<CharType>;
+    constexpr std::uint64_t non_ascii_bits = detail::non_ascii_bits<unit_size, swapped>;
+    if constexpr(Stop >= 0)
+    {
+        // Units equal to Stop become zero, the stored byte order puts the value into the highest byte if swapped
+        constexpr std::uint64_t stop_units =
+          detail::lowest_bits<unit_size> * (static_cast<std::uint64_t>(Stop) << (swapped ? 8 * (unit_size - 1) : 0));
+        while(end - p >= units_per_word)
+        {
+            const std::uint64_t word = detail::load64(p);
+            if((word & non_ascii_bits) || detail::has_zero_unit<unit_size>(word ^ stop_units))
+                break;
+            p += units_per_word;
+        }
+        while(p != end && detail::is_ascii(*p) && static_cast<std::uint32_t>(*p) != static_cast<std::uint32_t>(Stop))
+            ++p;
+    } else
+    {
+        while(end - p >= units_per_word && !(detail::load64(p) & non_ascii_bits))
+            p += units_per_word;
+        while(p != end && detail::is_ascii(*p))
+            ++p;
+    }
+    return p - begin;
+}
+
+///
+/// Copy \a count ASCII code units from \a in to \a out changing the code unit type
+///
+/// The byte order is changed at the same time if either is an endian_unit.
+/// As units are zero extended or narrowed with saturation, units below 0x100 are copied exactly too
+/// unless \a in is signed, e.g. Latin-1 can be copied from and to UTF-16/32.
+///
+/// \return the end of the output
+///
+template<typename CharOut, typename CharIn>
+CharOut* copy_ascii(const CharIn* NOWIDE_RESTRICT in, std::size_t count, CharOut* NOWIDE_RESTRICT out) noexcept
+{
+    static_assert(is_supported_unit<CharIn> && is_supported_unit<CharOut>, "Unsupported code unit type");
+    if constexpr(sizeof(CharOut) == sizeof(CharIn) && detail::is_swapped<CharOut> == detail::is_swapped<CharIn>)
+    {
+        std::memcpy(static_cast<void*>(out), in, count * sizeof(CharIn));
+        return out + count;
+    } else
+    {
+        const CharIn* const end = in + count;
+#ifdef NOWIDE_SIMD_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        if constexpr(sizeof(CharOut) == sizeof(CharIn))
+        {
+            // Only the byte order differs, so exactly one of them is swapped
+            using swapped_type = std::conditional_t<detail::is_swapped<CharIn>, CharIn, CharOut>;
+            for(; end - in >= static_cast<std::ptrdiff_t>(16 / sizeof(CharIn)); in += 16 / sizeof(CharIn))
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), detail::to_native<swapped_type>(v));
+                out += 16 / sizeof(CharOut);
+            }
+        } else if constexpr(sizeof(CharIn) == 1)
+        {
+            for(; end - in >= 16; in += 16, out += 16)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                const __m128i low = _mm_unpacklo_epi8(v, zero);
+                const __m128i high = _mm_unpackhi_epi8(v, zero);
+                __m128i* const dst = reinterpret_cast<__m128i*>(out);
+                if constexpr(sizeof(CharOut) == 2)
+                {
+                    _mm_storeu_si128(dst, detail::to_native<CharOut>(low));
+                    _mm_storeu_si128(dst + 1, detail::to_native<CharOut>(high));
+                } else
+                {
+                    _mm_storeu_si128(dst, detail::to_native<CharOut>(_mm_unpacklo_epi16(low, zero)));
+                    _mm_storeu_si128(dst + 1, detail::to_native<CharOut>(_mm_unpackhi_epi16(low, zero)));
+                    _mm_storeu_si128(dst + 2, detail::to_native<CharOut>(_mm_unpacklo_epi16(high, zero)));
+                    _mm_storeu_si128(dst + 3, detail::to_native<CharOut>(_mm_unpackhi_epi16(high, zero)));
+                }
+            }
+        } else if constexpr(sizeof(CharOut) == 1)
+        {
+            // All values are below 0x100, so the saturating packs are exact
+            const auto load = [](const CharIn* p) {
+                return detail::to_native<CharIn>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            };
+            for(; end - in >= 16; in += 16, out += 16)
+            {
+                __m128i packed;
+                if constexpr(sizeof(CharIn) == 2)
+                    packed = _mm_packus_epi16(load(in), load(in + 8));
+                else
+                {
+                    const __m128i low = _mm_packs_epi32(load(in), load(in + 4));
+                    const __m128i high = _mm_packs_epi32(load(in + 8), load(in + 12));
+                    packed = _mm_packus_epi16(low, high);
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packed);
+            }
+        }
+#endif
+        while(in != end)
+            *out++ = static_cast<CharOut>(static_cast<std::uint32_t>(*in++));
+        return out;
+    }
+}
+
+///
+/// Return the number of leading UTF-16/32 code units in [begin, end) which are below 0x100 and so Latin-1 characters
+///
+template<typename CharType>
+std::size_t latin1_length(const CharType* begin, const CharType* end) noexcept
+{
+    static_assert(is_supported_unit<CharType> && sizeof(CharType) > 1, "Unsupported code unit type");
+    constexpr std::ptrdiff_t unit_size = sizeof(CharType);
+    const CharType* p = begin;
+#ifdef NOWIDE_SIMD_SSE2
+    constexpr std::ptrdiff_t units_per_vector = 16 / unit_size;
+    const __m128i zero = _mm_setzero_si128();
+    while(end - p >= units_per_vector)
+    {
+        const __m128i v = detail::to_native<CharType>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        unsigned mask;
+        if constexpr(unit_size == 2)
+        {
+            const __m128i high_bits = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFF00)));
+            mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(high_bits, zero))) & 0xFFFFu;
+        } else
+        {
+            const __m128i high_bits = _mm_and_si128(v, _mm_set1_epi32(static_cast<int>(0xFFFFFF00)));
+            mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi32(high_bits, zero))) & 0xFFFFu;
+        }
+        if(mask)
+            return (p - begin) + detail::count_trailing_zeros(mask) / unit_size;
+        p += units_per_vector;
+    }
+#endif
+    constexpr std::uint64_t non_latin1_bits = detail::non_latin1_bits<unit_size, detail::is_swapped<CharType>>;
+    constexpr std::ptrdiff_t units_per_word = 8 / unit_size;
+    while(end - p >= units_per_word && !(detail::load64(p) & non_latin1_bits))
+        p += units_per_word;
+    while(p != end && static_cast<std::uint32_t>(*p) < 0x100)
+        ++p;
+    return p - begin;
+}
+
+///
+/// Convert \a count Latin-1 characters from \a in to UTF-8 at \a out, which must have room for 2 * \a count bytes
+///
+/// \return the end of the output
+///
+template<typename CharOut, typename CharIn>
+CharOut* latin1_to_utf8(const CharIn* NOWIDE_RESTRICT in, std::size_t count, CharOut* NOWIDE_RESTRICT out) noexcept
+{
+    static_assert(sizeof(CharIn) == 1 && sizeof(CharOut) == 1, "Unsupported code unit type");
+    const CharIn* const end = in + count;
+    while(in != end)
+    {
+        // Copy ASCII runs as a block, characters of the high half become 2 bytes
+        const std::size_t ascii = ascii_length(in, end);
+        out = copy_ascii(in, ascii, out);
+        in += ascii;
+        for(; in != end && !detail::is_ascii(*in); ++in)
+        {
+            const unsigned char c = static_cast<unsigned char>(*in);
+            *out++ = static_cast<CharOut>(0xC0 | (c >> 6));
+            *out++ = static_cast<CharOut>(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+}
+
+///
+/// Count the code units the UTF-8 input needs as UTF-16 (\a OutSize == 2) or UTF-32 (\a OutSize == 4)
+///
+/// Only complete sequences at the start of [begin, end) are counted and at most \a max code units.
+/// Like the decoder, a well formed but invalid sequence counts as one replacement character.
+/// The count may stop anywhere before that, e.g. at a non-ASCII character when SSE2 is not available,
+/// so the caller has to handle the remaining input.
+///
+/// \return the number of code units, \a begin is advanced over the counted input
+///
+template<std::size_t OutSize>
+std::size_t utf8_length(const char*& begin, const char* end, std::size_t max) noexcept
+{
+    static_assert(OutSize == 2 || OutSize == 4, "Unsupported output size");
+    const char* p = begin;
+    std::size_t count = 0;
+#ifdef NOWIDE_SIMD_SSE2
+    // A block of 16 bytes results in at most 20 UTF-16 code units
+    constexpr std::size_t max_units_per_block = 32;
+    if(end - p >= 16 && max >= max_units_per_block)
+    {
+        // Classify the bytes by signed comparisons: ASCII is positive, continuation bytes are below -64 (0xC0),
+        // a lead byte needs as many continuation bytes as it is above -64 (0xC0), -32 (0xE0), -16 (0xF0)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i prev_bytes = zero, prev_lead = zero, prev_lead3 = zero, prev_lead4 = zero;
+        while(end - p >= 16 && max - count >= max_units_per_block)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // Fast path for ASCII not continuing a sequence of the previous block
+            if(!_mm_movemask_epi8(_mm_or_si128(bytes, _mm_srli_si128(prev_lead, 13))))
+            {
+                count += 16;
+                p += 16;
+                prev_bytes = prev_lead = prev_lead3 = prev_lead4 = zero;
+                continue;
+            }
+            const __m128i non_ascii = _mm_cmplt_epi8(bytes, zero);
+            const __m128i trail = _mm_cmplt_epi8(bytes, _mm_set1_epi8(-64));
+            const __m128i lead = _mm_andnot_si128(trail, non_ascii);
+            const __m128i lead3 = _mm_and_si128(non_ascii, _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-33)));
+            const __m128i lead4 = _mm_and_si128(non_ascii, _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-17)));
+            // Overlong leads 0xC0, 0xC1 and leads above U+10FFFF
+            __m128i error = _mm_or_si128(_mm_and_si128(lead, _mm_cmplt_epi8(bytes, _mm_set1_epi8(-62))),
+                                         _mm_and_si128(non_ascii, _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-12))));
+            // Continuation bytes must be exactly those following a lead byte
+            const __m128i expected_trail = _mm_or_si128(
+              detail::shift_in<1>(lead, prev_lead),
+              _mm_or_si128(detail::shift_in<2>(lead3, prev_lead3), detail::shift_in<3>(lead4, prev_lead4)));
+            error = _mm_or_si128(error, _mm_xor_si128(expected_trail, trail));
+            // Other invalid sequences are replaced by a single character, like valid ones.
+            // Only overlong 4 byte sequences and those above U+10FFFF don't need a surrogate pair.
+            if constexpr(OutSize == 2)
+            {
+                const __m128i prev = detail::shift_in<1>(bytes, prev_bytes);
+                const __m128i after_f0 = _mm_cmpeq_epi8(prev, _mm_set1_epi8('\xF0'));
+                const __m128i after_f4 = _mm_cmpeq_epi8(prev, _mm_set1_epi8('\xF4'));
+                error = _mm_or_si128(error, _mm_and_si128(after_f0, _mm_cmplt_epi8(bytes, _mm_set1_epi8(-112))));
+                error = _mm_or_si128(error, _mm_and_si128(after_f4, _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-113))));
+            }
+            if(_mm_movemask_epi8(error))
+                break;
+            // Each sequence is one code unit, those starting with a 4 byte lead are 2 in UTF-16
+            count += 16 - detail::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(trail)));
+            if constexpr(OutSize == 2)
+                count += detail::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(lead4)));
+            prev_bytes = bytes;
+            prev_lead = lead;
+            prev_lead3 = lead3;
+            prev_lead4 = lead4;
+            p += 16;
+        }
+        // The last sequence may continue after the last block and is not validated, so exclude it
+        for(int i = 1; i <= 3 && p - begin >= i; i++)
+        {
+            const unsigned char c = static_cast<unsigned char>(p[-i]);
+            if(c < 0x80)
+                break;
+            if(c >= 0xC0)
+            {
+                const int length = c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2);
+                if(length > i)
+                {
+                    p -= i;
+                    count -= (OutSize == 2 && length == 4) ? 2 : 1;
+                }
+                break;
+            }
+        }
+    }
+#endif
+    const std::size_t ascii_count =
+      ascii_length(p, p + std::min<std::size_t>(end - p, max - count));
+    begin = p + ascii_count;
+    return count + ascii_count;
+}
+} // namespace nowide::utf::simd
+
+#endif
@@ -0,0 +1,202 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_UTF_SINGLE_BYTE_HPP_INCLUDED
+#define NOWIDE_UTF_SINGLE_BYTE_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <nowide/utf/utf.hpp>
+#include <type_traits>
+
+namespace nowide::utf {
+/// \cond INTERNAL
+namespace detail {
+    using single_byte_table = std::array<code_point, 256>;
+
+    /// Table mapping each byte to the code point with the same value,
+    /// with bytes [0x80, 0xA0) replaced by the 32 code points at \a c1 if not NULL
+    constexpr single_byte_table make_single_byte_table(const code_point* c1) noexcept
+    {
+        single_byte_table result{};
+        for(std::size_t i = 0; i < result.size(); i++)
+            result[i] = (c1 && i >= 0x80 && i < 0xA0) ? c1[i - 0x80] : static_cast<code_point>(i);
+        return result;
+    }
+
+    struct reverse_entry
+    {
+        code_point value;
+        unsigned char byte;
+    };
+    using reverse_table = std::array<reverse_entry, 128>;
+
+    /// Code points of the non ASCII bytes of \a table with their byte sorted by code point
+    constexpr reverse_table make_reverse_table(const single_byte_table& table) noexcept
+    {
+        reverse_table result{};
+        for(std::size_t i = 0; i < result.size(); i++)
+        {
+            // Insertion sort
+            const reverse_entry entry{table[i + 0x80], static_cast<unsigned char>(i + 0x80)};
+            std::size_t j = i;
+            for(; j > 0 && result[j - 1].value > entry.value; j--)
+                result[j] = result[j - 1];
+            result[j] = entry;
+        }
+        return result;
+    }
+
+    constexpr code_point windows1252_c1[32] = {
+      0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160,
+      0x2039, 0x0152, 0x008D, 0x017D, 0x008F, 0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022,
+      0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178};
+} // namespace detail
+/// \endcond
+
+///
+/// \brief ISO-8859-1, each byte is the code point of the same value
+///
+struct latin1_table
+{
+    /// True if the table is the identity, which allows widening by zero extension
+    static constexpr bool is_latin1 = true;
+    /// Code point of each byte
+    static constexpr detail::single_byte_table to_unicode = detail::make_single_byte_table(nullptr);
+};
+
+///
+/// \brief Windows-1252, ISO-8859-1 with printable characters in [0x80, 0xA0)
+///
+/// The 5 bytes undefined in Windows-1252 map to the C1 control characters like on Windows.
+///
+struct windows1252_table
+{
+    /// True if the table is the identity, which allows widening by zero extension
+    static constexpr bool is_latin1 = false;
+    /// Code point of each byte
+    static constexpr detail::single_byte_table to_unicode = detail::make_single_byte_table(detail::windows1252_c1);
+};
+
+///
+/// \brief A code unit of the single byte encoding given by the code points of all 256 bytes in \tparam Table
+///
+/// The encoding must be ASCII compatible. Like utf::endian_unit it converts implicitly from and to the
+/// byte value and can be used as the character type of utf_traits and all conversion functions,
+/// e.g. `utf::convert_string<char>(latin1_begin, latin1_end)`.
+///
+template<typename Table>
+class single_byte_char
+{
+public:
+    /// The table defining the encoding
+    using table_type = Table;
+
+    single_byte_char() = default;
+    constexpr single_byte_char(unsigned char value) noexcept : value_(value)
+    {}
+    constexpr operator unsigned char() const noexcept
+    {
+        return value_;
+    }
+
+private:
+    unsigned char value_;
+};
+
+/// ISO-8859-1 character
+using latin1_char = single_byte_char<latin1_table>;
+/// Windows-1252 character
+using windows1252_char = single_byte_char<windows1252_table>;
+
+///
+/// True if \tparam CharType is a single_byte_char
+///
+template<typename CharType>
+struct is_single_byte_char : std::false_type
+{};
+template<typename Table>
+struct is_single_byte_char<single_byte_char<Table>> : std::true_type
+{};
+
+///
+/// \brief utf_traits for single byte encodings
+///
+/// Each byte is one code point, so there are no incomplete or illegal sequences.
+/// Code points which can't be encoded are replaced by '?' like on Windows.
+///
+template<typename Table>
+struct utf_traits<single_byte_char<Table>, 1>
+{
+    using char_type = single_byte_char<Table>;
+
+    static constexpr int max_width = 1;
+
+    static constexpr int trail_length(char_type /*c*/) noexcept
+    {
+        return 0;
+    }
+    static constexpr bool is_trail(char_type /*c*/) noexcept
+    {
+        return false;
+    }
+    static constexpr bool is_lead(char_type /*c*/) noexcept
+    {
+        return true;
+    }
+    static constexpr int width(code_point /*u*/) noexcept
+    {
+        return 1;
+    }
+
+    template<typename It>
+    static constexpr code_point decode_valid(It& current) noexcept(noexcept(*current++))
+    {
+        return Table::to_unicode[static_cast<unsigned char>(*current++)];
+    }
+    template<typename It>
+    static constexpr code_point decode(It& current, It last) noexcept(noexcept(*current++))
+    {
+        NOWIDE_UNLIKELY_IF(current == last)
+            return incomplete;
+        return decode_valid(current);
+    }
+
+    /// Return the byte encoding \a u or -1 if it can't be encoded
+    static int to_byte(code_point u) noexcept
+    {
+        if constexpr(Table::is_latin1)
+            return u <= 0xFF ? static_cast<int>(u) : -1;
+        else
+        {
+            NOWIDE_LIKELY_IF(u < 0x80)
+                return static_cast<int>(u);
+            const auto it = std::lower_bound(
+              reverse_table.begin(), reverse_table.end(), u, [](const detail::reverse_entry& entry, code_point value) {
+                  return entry.value < value;
+              });
+            if(it == reverse_table.end() || it->value != u)
+                return -1;
+            return it->byte;
+        }
+    }
+    template<typename It>
+    static It encode(code_point u, It out) noexcept(noexcept(*out++))
+    {
+        const int byte = to_byte(u);
+        *out++ = char_type(static_cast<unsigned char>(byte < 0 ? '?' : byte));
+        return out;
+    }
+
+private:
+    static constexpr detail::reverse_table reverse_table = detail::make_reverse_table(Table::to_unicode);
+};
+
+} // namespace nowide::utf
+
+#endif
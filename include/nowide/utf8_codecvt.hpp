@@ -12,7 +12,9 @@
 
 #include <cstring>
 #include <locale>
+#include <algorithm>
 #include <nowide/replacement.hpp>
+#include <nowide/utf/simd.hpp>
 #include <nowide/utf/utf.hpp>
 
 namespace nowide {
@@ -28,6 +30,94 @@ namespace detail {
     {
         std::memcpy(&dst, &src, 2);
     }
+
+    /// Convert UTF-8 to UTF-16/32 as long as any UTF-8 sequence is complete and a surrogate pair fits
+    ///
+    /// This handles the bulk of a buffer with ASCII runs being copied as blocks.
+    /// What is left near the ends of the buffers is done by the state machine of the codecvt.
+    template<typename CharType>
+    void utf8_to_utf_bulk(const char*& from, const char* from_end, CharType*& to, CharType* to_end) noexcept
+    {
+        using decoder = utf::utf_traits<char>;
+        using encoder = utf::utf_traits<CharType>;
+        while(from_end - from >= decoder::max_width && to_end - to >= encoder::max_width)
+        {
+            const unsigned char lead = static_cast<unsigned char>(*from);
+            if(lead < 0x80)
+            {
+                const std::size_t max_count = std::min<std::size_t>(from_end - from, to_end - to);
+                const std::size_t count = utf::simd::ascii_length(from, from + max_count);
+                to = utf::simd::copy_ascii(from, count, to);
+                from += count;
+                continue;
+            }
+            // Enough input is available, so the trail bytes can be read without range checks
+            const unsigned char trail1 = static_cast<unsigned char>(from[1]);
+            const unsigned char trail2 = static_cast<unsigned char>(from[2]);
+            if(lead >= 0xC2 && lead < 0xE0 && decoder::is_trail(trail1))
+            {
+                *to++ = static_cast<CharType>((lead & 0x1F) << 6 | (trail1 & 0x3F));
+                from += 2;
+                continue;
+            }
+            if(lead >= 0xE0 && lead < 0xF0 && decoder::is_trail(trail1) && decoder::is_trail(trail2))
+            {
+                const utf::code_point c = (lead & 0x0F) << 12 | (trail1 & 0x3F) << 6 | (trail2 & 0x3F);
+                // Reject overlong encodings and surrogates
+                NOWIDE_LIKELY_IF(c >= 0x800 && (c < 0xD800 || c > 0xDFFF))
+                {
+                    *to++ = static_cast<CharType>(c);
+                    from += 3;
+                    continue;
+                }
+            }
+            // Everything else: 4 byte sequences and invalid input
+            utf::code_point c = decoder::decode(from, from_end);
+            // Can't be incomplete as enough input is available
+            if(c == utf::illegal)
+                c = NOWIDE_REPLACEMENT_CHARACTER;
+            to = encoder::encode(c, to);
+        }
+    }
+
+    /// Convert UTF-16/32 to UTF-8 as long as any code point fits
+    ///
+    /// This handles the bulk of a buffer with ASCII runs being copied as blocks.
+    /// Stops at anything needing the state machine of the codecvt: The ends of the buffers
+    /// and surrogates which are not part of a complete pair.
+    template<typename CharType>
+    void utf_to_utf8_bulk(const CharType*& from, const CharType* from_end, char*& to, char* to_end) noexcept
+    {
+        using encoder = utf::utf_traits<char>;
+        while(from != from_end && to_end - to >= encoder::max_width)
+        {
+            if(static_cast<std::uint32_t>(*from) < 0x80)
+            {
+                const std::size_t max_count = std::min<std::size_t>(from_end - from, to_end - to);
+                const std::size_t count = utf::simd::ascii_length(from, from + max_count);
+                to = utf::simd::copy_ascii(from, count, to);
+                from += count;
+                continue;
+            }
+            utf::code_point c = static_cast<std::uint32_t>(*from);
+            if constexpr(sizeof(CharType) == 2)
+            {
+                if(0xD800 <= c && c <= 0xDFFF)
+                {
+                    if(c > 0xDBFF || from_end - from < 2)
+                        return;
+                    const utf::code_point c2 = static_cast<std::uint32_t>(from[1]);
+                    if(c2 < 0xDC00 || 0xDFFF < c2)
+                        return;
+                    c = ((c - 0xD800) << 10 | (c2 - 0xDC00)) + 0x10000;
+                    ++from;
+                }
+            } else if(!utf::is_valid_codepoint(c))
+                c = NOWIDE_REPLACEMENT_CHARACTER;
+            to = encoder::encode(c, to);
+            ++from;
+        }
+    }
 } // namespace detail
 
 /// std::codecvt implementation that converts between UTF-8 and UTF-16 or UTF-32
@@ -88,6 +178,12 @@ protected:
         const char* save_from = from;
         while(max > 0 && from < from_end)
         {
+            if(state == 0)
+            {
+                max -= utf::simd::utf8_length<2>(from, from_end, max);
+                if(max == 0 || from == from_end)
+                    break;
+            }
             const char* prev_from = from;
             char32_t ch = utf::utf_traits<char>::decode(from, from_end);
             if(ch == utf::illegal)
@@ -98,18 +194,19 @@ protected:
                 from = prev_from;
                 break;
             }
-            max--;
             if(ch > 0xFFFF)
             {
-                if(state == 0)
+                if(state != 0)
+                    state = 0;
+                else if(max == 1)
                 {
+                    // Only the first surrogate fits, see do_in
                     from = prev_from;
                     state = 1;
                 } else
-                {
-                    state = 0;
-                }
+                    max--;
             }
+            max--;
         }
         detail::write_state(std_state, state);
         return static_cast<int>(from - save_from);
@@ -133,6 +230,12 @@ protected:
         char16_t state = detail::read_state(std_state);
         while(to < to_end && from < from_end)
         {
+            if(state == 0)
+            {
+                detail::utf8_to_utf_bulk(from, from_end, to, to_end);
+                if(to == to_end || from == from_end)
+                    break;
+            }
             const char* from_saved = from;
 
             char32_t ch = utf::utf_traits<char>::decode(from, from_end);
@@ -152,7 +255,7 @@ protected:
                 *to++ = static_cast<CharType>(ch);
             } else
             {
-                // for  other codepoints we do following
+                // Both surrogates are written at once if they fit, otherwise:
                 //
                 // 1. We can't consume our input as we may find ourself
                 //    in state where all input consumed but not all output written,i.e. only
@@ -166,15 +269,19 @@ protected:
                 char16_t vl = static_cast<char16_t>(ch & 0x3FF);
                 char16_t w1 = vh + 0xD800;
                 char16_t w2 = vl + 0xDC00;
-                if(state == 0)
+                if(state != 0)
+                {
+                    *to++ = static_cast<CharType>(w2);
+                    state = 0;
+                } else if(to_end - to >= 2)
                 {
-                    from = from_saved;
                     *to++ = static_cast<CharType>(w1);
-                    state = 1;
+                    *to++ = static_cast<CharType>(w2);
                 } else
                 {
-                    *to++ = static_cast<CharType>(w2);
-                    state = 0;
+                    from = from_saved;
+                    *to++ = static_cast<CharType>(w1);
+                    state = 1;
                 }
             }
         }
@@ -205,6 +312,12 @@ protected:
         char16_t state = detail::read_state(std_state);
         while(to < to_end && from < from_end)
         {
+            if(state == 0)
+            {
+                detail::utf_to_utf8_bulk(from, from_end, to, to_end);
+                if(to == to_end || from == from_end)
+                    break;
+            }
             char32_t ch = 0;
             if(state != 0)
             {
@@ -301,6 +414,9 @@ protected:
         const char* start_from = from;
         while(max > 0 && from < from_end)
         {
+            max -= utf::simd::utf8_length<4>(from, from_end, max);
+            if(max == 0 || from == from_end)
+                break;
             const char* save_from = from;
             char32_t ch = utf::utf_traits<char>::decode(from, from_end);
             if(ch == utf::incomplete)
@@ -328,6 +444,9 @@ protected:
 
         while(to < to_end && from < from_end)
         {
+            detail::utf8_to_utf_bulk(from, from_end, to, to_end);
+            if(to == to_end || from == from_end)
+                break;
             const char* from_saved = from;
 
             char32_t ch = utf::utf_traits<char>::decode(from, from_end);
@@ -361,6 +480,9 @@ protected:
         std::codecvt_base::result r = std::codecvt_base::ok;
         while(to < to_end && from < from_end)
         {
+            detail::utf_to_utf8_bulk(from, from_end, to, to_end);
+            if(to == to_end || from == from_end)
+                break;
             char32_t ch = 0;
             ch = *from;
             if(!utf::is_valid_codepoint(ch))
@@ -0,0 +1,57 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_UTF8_LOCALE_HPP_INCLUDED
+#define NOWIDE_UTF8_LOCALE_HPP_INCLUDED
+
+#include <ios>
+#include <locale>
+#include <nowide/utf8_codecvt.hpp>
+#include <streambuf>
+
+namespace nowide {
+///
+/// \brief Return the shared locale converting between UTF-8 and wchar_t, char16_t and char32_t
+///
+/// It is the classic locale with the utf8_codecvt facets installed. The locale is built on the first call
+/// (thread safe), later calls only return it, so imbuing a stream with it neither constructs a locale
+/// nor allocates.
+///
+inline const std::locale& utf8_locale()
+{
+    static const std::locale instance = [] {
+        const std::locale wide(std::locale::classic(), new utf8_codecvt<wchar_t>());
+        const std::locale utf16(wide, new utf8_codecvt<char16_t>());
+        return std::locale(utf16, new utf8_codecvt<char32_t>());
+    }();
+    return instance;
+}
+
+///
+/// Imbue the stream \a s with utf8_locale()
+///
+/// \return the previous locale of the stream
+///
+template<typename CharType, typename Traits>
+std::locale imbue_utf8(std::basic_ios<CharType, Traits>& s)
+{
+    return s.imbue(utf8_locale());
+}
+
+///
+/// Imbue the stream buffer \a buf with utf8_locale()
+///
+/// \return the previous locale of the stream buffer
+///
+template<typename CharType, typename Traits>
+std::locale imbue_utf8(std::basic_streambuf<CharType, Traits>& buf)
+{
+    return buf.pubimbue(utf8_locale());
+}
+} // namespace nowide
+
+#endif
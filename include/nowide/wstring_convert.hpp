@@ -0,0 +1,137 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef NOWIDE_WSTRING_CONVERT_HPP_INCLUDED
+#define NOWIDE_WSTRING_CONVERT_HPP_INCLUDED
+
+#include <cwchar>
+#include <nowide/scratch.hpp>
+#include <string>
+#include <string_view>
+
+namespace nowide {
+///
+/// \brief Replacement for the deprecated std::wstring_convert using UTF-8 as the byte encoding
+///
+/// `std::wstring_convert<nowide::utf8_codecvt<CharOut>, CharOut>` can be replaced by
+/// `nowide::wstring_convert<CharOut>`. The conversion doesn't go through the virtual codecvt interface
+/// and reuses internal buffers between calls, so only the returned strings are allocated.
+/// The view variants from_bytes_view() and to_bytes_view() don't allocate at all once the buffers are large enough.
+///
+/// Unlike std::wstring_convert no std::range_error is thrown: Invalid UTF sequences are replaced
+/// with the replacement character, see #NOWIDE_REPLACEMENT_CHARACTER, and the whole input is always converted.
+///
+/// An instance must not be used from multiple threads at the same time.
+///
+template<typename CharOut = wchar_t>
+class wstring_convert
+{
+public:
+    /// Type of the wide strings
+    using wide_string = std::basic_string<CharOut>;
+    /// Type of the byte (UTF-8) strings
+    using byte_string = std::string;
+    /// Type of the conversion state, conversions are stateless
+    using state_type = std::mbstate_t;
+
+    wstring_convert() = default;
+    wstring_convert(const wstring_convert&) = delete;
+    wstring_convert& operator=(const wstring_convert&) = delete;
+
+    /// Convert the UTF-8 character \a byte
+    wide_string from_bytes(char byte)
+    {
+        return wide_string(from_bytes_view(std::string_view(&byte, 1)));
+    }
+    /// Convert the NULL terminated UTF-8 string \a ptr
+    wide_string from_bytes(const char* ptr)
+    {
+        return wide_string(from_bytes_view(std::string_view(ptr)));
+    }
+    /// Convert the UTF-8 string \a str
+    wide_string from_bytes(const byte_string& str)
+    {
+        return wide_string(from_bytes_view(str));
+    }
+    /// Convert the UTF-8 string in range [first, last)
+    wide_string from_bytes(const char* first, const char* last)
+    {
+        return wide_string(from_bytes_view(std::string_view(first, last - first)));
+    }
+    ///
+    /// Convert the UTF-8 string \a str into the internal buffer
+    ///
+    /// The view stays valid until the next call to from_bytes or from_bytes_view
+    ///
+    std::basic_string_view<CharOut> from_bytes_view(std::string_view str)
+    {
+        return convert(wide_buffer_, str);
+    }
+
+    /// Convert the wide character \a wchar
+    byte_string to_bytes(CharOut wchar)
+    {
+        return byte_string(to_bytes_view(std::basic_string_view<CharOut>(&wchar, 1)));
+    }
+    /// Convert the NULL terminated wide string \a wptr
+    byte_string to_bytes(const CharOut* wptr)
+    {
+        return byte_string(to_bytes_view(std::basic_string_view<CharOut>(wptr)));
+    }
+    /// Convert the wide string \a wstr
+    byte_string to_bytes(const wide_string& wstr)
+    {
+        return byte_string(to_bytes_view(wstr));
+    }
+    /// Convert the wide string in range [first, last)
+    byte_string to_bytes(const CharOut* first, const CharOut* last)
+    {
+        return byte_string(to_bytes_view(std::basic_string_view<CharOut>(first, last - first)));
+    }
+    ///
+    /// Convert the wide string \a wstr into the internal buffer
+    ///
+    /// The view stays valid until the next call to to_bytes or to_bytes_view
+    ///
+    std::string_view to_bytes_view(std::basic_string_view<CharOut> wstr)
+    {
+        return convert(byte_buffer_, wstr);
+    }
+
+    /// Return the number of input characters converted by the last conversion
+    std::size_t converted() const noexcept
+    {
+        return converted_;
+    }
+    /// Return the conversion state, which is always the initial state
+    state_type state() const noexcept
+    {
+        return state_type();
+    }
+
+private:
+    template<typename Out, typename In>
+    std::basic_string_view<Out> convert(scratch::detail::buffer<Out>& buffer, std::basic_string_view<In> input)
+    {
+        // Every input char is transcoded to the output char with maximum width
+        const std::size_t max_size = input.size() * utf::utf_traits<Out>::max_width;
+        Out* const begin = buffer.reserve(max_size);
+        Out* end = begin;
+        const In* source = input.data();
+        utf::convert_prefix(end, begin + max_size, source, source + input.size());
+        converted_ = source - input.data();
+        return {begin, static_cast<std::size_t>(end - begin)};
+    }
+
+    scratch::detail::buffer<CharOut> wide_buffer_;
+    scratch::detail::buffer<char> byte_buffer_;
+    std::size_t converted_{0};
+}; // wstring_convert
+
+} // namespace nowide
+
+#endif
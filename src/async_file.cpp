@@ -0,0 +1,71 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#define NOWIDE_SOURCE
+
+#if(defined(__MINGW32__) || defined(__CYGWIN__)) && defined(__STRICT_ANSI__)
+// Need the _w* functions which are extensions on MinGW/Cygwin
+#undef __STRICT_ANSI__
+#endif
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+#include <cerrno>
+#include <io.h>
+#include <nowide/async_file.hpp>
+
+namespace nowide::detail {
+namespace {
+    /// Set up \a overlapped to access the file at \a offset
+    OVERLAPPED make_overlapped(std::uint64_t offset) noexcept
+    {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        return overlapped;
+    }
+    int last_error_to_errno() noexcept
+    {
+        switch(GetLastError())
+        {
+        case ERROR_INVALID_HANDLE: return EBADF;
+        case ERROR_ACCESS_DENIED: return EACCES;
+        case ERROR_DISK_FULL:
+        case ERROR_HANDLE_DISK_FULL: return ENOSPC;
+        default: return EIO;
+        }
+    }
+} // namespace
+
+std::ptrdiff_t fd_pread(int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept
+{
+    const HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    if(file == INVALID_HANDLE_VALUE)
+        return -EBADF;
+    OVERLAPPED overlapped = make_overlapped(offset);
+    DWORD count = 0;
+    if(!ReadFile(file, buffer, static_cast<DWORD>(std::min<std::size_t>(size, MAXDWORD)), &count, &overlapped))
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -last_error_to_errno();
+    return count;
+}
+
+std::ptrdiff_t fd_pwrite(int fd, const void* buffer, std::size_t size, std::uint64_t offset) noexcept
+{
+    const HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    if(file == INVALID_HANDLE_VALUE)
+        return -EBADF;
+    OVERLAPPED overlapped = make_overlapped(offset);
+    DWORD count = 0;
+    if(!WriteFile(file, buffer, static_cast<DWORD>(std::min<std::size_t>(size, MAXDWORD)), &count, &overlapped))
+        return -last_error_to_errno();
+    return count;
+}
+} // namespace nowide::detail
@@ -0,0 +1,38 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#define NOWIDE_SOURCE
+
+#if(defined(__MINGW32__) || defined(__CYGWIN__)) && defined(__STRICT_ANSI__)
+// Need the _w* functions which are extensions on MinGW/Cygwin
+#undef __STRICT_ANSI__
+#endif
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+#include <nowide/atomic_writer.hpp>
+
+namespace nowide::detail {
+bool replace_file(const wchar_t* from, const wchar_t* to) noexcept
+{
+    return MoveFileExW(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+bool remove_file(const wchar_t* name) noexcept
+{
+    return DeleteFileW(name) != 0;
+}
+
+unsigned long process_id() noexcept
+{
+    return GetCurrentProcessId();
+}
+} // namespace nowide::detail
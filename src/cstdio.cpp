@@ -24,27 +24,35 @@ namespace nowide {
 std::FILE*
 freopen(const char* NOWIDE_RESTRICT file_name, const char* NOWIDE_RESTRICT mode, std::FILE* NOWIDE_RESTRICT stream)
 {
-    const wstackstring wname(file_name);
+    const detail::wpath_stackstring wname(file_name);
+    if(detail::is_name_too_long(file_name, wname))
+        return nullptr;
     const wshort_stackstring wmode(mode);
     return _wfreopen(wname.data(), wmode.data(), stream);
 }
 
 std::FILE* fopen(const char* NOWIDE_RESTRICT file_name, const char* NOWIDE_RESTRICT mode)
 {
-    const wstackstring wname(file_name);
+    const detail::wpath_stackstring wname(file_name);
+    if(detail::is_name_too_long(file_name, wname))
+        return nullptr;
     const wshort_stackstring wmode(mode);
     return _wfopen(wname.data(), wmode.data());
 }
 
 int rename(const char* old_name, const char* new_name)
 {
-    const wstackstring wold(old_name), wnew(new_name);
+    const detail::wpath_stackstring wold(old_name), wnew(new_name);
+    if(detail::is_name_too_long(old_name, wold) || detail::is_name_too_long(new_name, wnew))
+        return -1;
     return _wrename(wold.data(), wnew.data());
 }
 
 int remove(const char* name)
 {
-    const wstackstring wname(name);
+    const detail::wpath_stackstring wname(name);
+    if(detail::is_name_too_long(name, wname))
+        return -1;
     return _wremove(wname.data());
 }
 } // namespace nowide
@@ -168,20 +168,12 @@ namespace detail {
                 {
                     buffer_[1] = traits_type::to_char_type(NOWIDE_REPLACEMENT_CHARACTER);
                     out_size = 1;
-                } else
+                } else if(code == '\r')
                 {
-                    CharType* p = encoder::encode(code, buffer_ + 1);
-                    for(CharType* pcur = buffer_ + 1; pcur < p;)
-                    {
-                        if(*pcur == CharType{'\r'})
-                        {
-                            std::memmove(pcur, pcur + 1, (p - pcur - 1) * sizeof(CharType));
-                            p--;
-                        } else
-                            pcur++;
-                    }
-                    out_size = p - buffer_ - 1;
-                }
+                    // The console returns CR LF for a newline, a CR can only be the whole code point
+                    out_size = 0;
+                } else
+                    out_size = encoder::encode(code, buffer_ + 1) - buffer_ - 1;
                 std::memset(wbuffer_, 0, sizeof(wbuffer_));
                 if(out_size == 0)
                     continue;
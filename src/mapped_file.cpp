@@ -0,0 +1,71 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#define NOWIDE_SOURCE
+
+#if(defined(__MINGW32__) || defined(__CYGWIN__)) && defined(__STRICT_ANSI__)
+// Need the _w* functions which are extensions on MinGW/Cygwin
+#undef __STRICT_ANSI__
+#endif
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+#include <io.h>
+#include <nowide/mapped_file.hpp>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace nowide::detail {
+std::int64_t regular_file_size(int fd) noexcept
+{
+    struct _stat64 st;
+    if(_fstat64(fd, &st) != 0 || !(st.st_mode & _S_IFREG))
+        return -1;
+    return st.st_size;
+}
+
+void* map_file(int fd, std::size_t size, map_access access, map_options /*options*/) noexcept
+{
+    const HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    if(file == INVALID_HANDLE_VALUE)
+        return nullptr;
+    const bool read_only = access == map_access::read_only;
+    const HANDLE mapping =
+      CreateFileMappingW(file, nullptr, read_only ? PAGE_READONLY : PAGE_READWRITE, 0, 0, nullptr);
+    if(!mapping)
+        return nullptr;
+    // The view keeps the mapping object alive
+    void* const address = MapViewOfFile(mapping, read_only ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+    CloseHandle(mapping);
+    return address;
+}
+
+void unmap_file(void* address, std::size_t /*size*/) noexcept
+{
+    UnmapViewOfFile(address);
+}
+
+bool flush_mapping(int fd, void* address, std::size_t size) noexcept
+{
+    const HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    return FlushViewOfFile(address, size) && FlushFileBuffers(file);
+}
+
+bool advise_mapping(void* /*address*/, std::size_t /*size*/, map_advice /*advice*/) noexcept
+{
+    return true;
+}
+
+bool resize_file(int fd, std::uint64_t size) noexcept
+{
+    return _chsize_s(fd, static_cast<__int64>(size)) == 0;
+}
+} // namespace nowide::detail
@@ -20,7 +20,9 @@
 namespace nowide::detail {
 int stat(const char* NOWIDE_RESTRICT path, stat_t* NOWIDE_RESTRICT buffer, std::size_t buffer_size)
 {
-    const wstackstring wpath(path);
+    const wpath_stackstring wpath(path);
+    if(is_name_too_long(path, wpath))
+        return -1;
     switch(buffer_size)
     {
 #ifndef _WIN64
@@ -33,7 +35,9 @@ int stat(const char* NOWIDE_RESTRICT path, stat_t* NOWIDE_RESTRICT buffer, std::
 
 int stat(const char* NOWIDE_RESTRICT path, posix_stat_t* NOWIDE_RESTRICT buffer, std::size_t buffer_size)
 {
-    const wstackstring wpath(path);
+    const wpath_stackstring wpath(path);
+    if(is_name_too_long(path, wpath))
+        return -1;
     switch(buffer_size)
     {
 #ifndef _WIN64
@@ -19,6 +19,7 @@
 #include <map>
 #include <nowide/convert.hpp>
 #include <nowide/cstdio.hpp>
+#include <nowide/fd_filebuf.hpp>
 #include <nowide/fstream.hpp>
 #include <stdexcept>
 #include <vector>
@@ -27,6 +28,8 @@
 
 namespace nw = nowide;
 
+static constexpr int DATA_SIZE = 64 * 1024 * 1024;
+
 template<typename FStream>
 class io_fstream
 {
@@ -59,10 +62,20 @@ public:
         f_ << std::flush;
     }
 
-private:
+protected:
     FStream f_;
 };
 
+class io_fd_preallocated : public io_fstream<nw::fd_fstream>
+{
+public:
+    explicit io_fd_preallocated(const char* file, bool read) : io_fstream<nw::fd_fstream>(file, read)
+    {
+        if(!read)
+            f_.rdbuf()->preallocate(DATA_SIZE);
+    }
+};
+
 class io_stdio
 {
 public:
@@ -142,7 +155,7 @@ perf_data test_io(const char* file)
     perf_data results;
     // Use vector to force write to memory and avoid possible reordering
     std::vector<clock::time_point> start_and_end(2);
-    const int data_size = 64 * 1024 * 1024;
+    const int data_size = DATA_SIZE;
     for(int block_size = MIN_BLOCK_SIZE / 2; block_size <= MAX_BLOCK_SIZE; block_size *= 2)
     {
         std::vector<char> buf = get_rand_data(block_size);
@@ -215,18 +228,25 @@ perf_data test_io_driver(const char* file, const char* type)
 
 void print_perf_data(const std::map<size_t, double>& stdio_data,
                      const std::map<size_t, double>& std_data,
-                     const std::map<size_t, double>& nowide_data)
+                     const std::map<size_t, double>& nowide_data,
+                     const std::map<size_t, double>& fd_data,
+                     const std::map<size_t, double>& fd_preallocated_data)
 {
     std::cout << "block size"
               << "     stdio    "
               << " std::fstream "
-              << "nowide::fstream" << std::endl;
+              << "nowide::fstream"
+              << " fd_fstream "
+              << " preallocated " << std::endl;
     for(int block_size = MIN_BLOCK_SIZE; block_size <= MAX_BLOCK_SIZE; block_size *= 2)
     {
         std::cout << std::setw(8) << block_size << "  ";
         std::cout << std::fixed << std::setprecision(3) << std::setw(8) << stdio_data.at(block_size) << " MB/s ";
         std::cout << std::fixed << std::setprecision(3) << std::setw(8) << std_data.at(block_size) << " MB/s ";
         std::cout << std::fixed << std::setprecision(3) << std::setw(8) << nowide_data.at(block_size) << " MB/s ";
+        std::cout << std::fixed << std::setprecision(3) << std::setw(8) << fd_data.at(block_size) << " MB/s ";
+        std::cout << std::fixed << std::setprecision(3) << std::setw(8) << fd_preallocated_data.at(block_size)
+                  << " MB/s ";
         std::cout << std::endl;
     }
 }
@@ -236,10 +256,12 @@ void test_perf(const char* file)
     perf_data stdio_data = test_io_driver<io_stdio>(file, "stdio");
     perf_data std_data = test_io_driver<io_fstream<std::fstream>>(file, "std::fstream");
     perf_data nowide_data = test_io_driver<io_fstream<nw::fstream>>(file, "nowide::fstream");
+    perf_data fd_data = test_io_driver<io_fstream<nw::fd_fstream>>(file, "nowide::fd_fstream");
+    perf_data fd_preallocated_data = test_io_driver<io_fd_preallocated>(file, "preallocated nowide::fd_fstream");
     std::cout << "================== Read performance ==================" << std::endl;
-    print_perf_data(stdio_data.read, std_data.read, nowide_data.read);
+    print_perf_data(stdio_data.read, std_data.read, nowide_data.read, fd_data.read, fd_preallocated_data.read);
     std::cout << "================== Write performance =================" << std::endl;
-    print_perf_data(stdio_data.write, std_data.write, nowide_data.write);
+    print_perf_data(stdio_data.write, std_data.write, nowide_data.write, fd_data.write, fd_preallocated_data.write);
 }
 
 int main(int argc, char** argv)
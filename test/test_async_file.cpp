@@ -0,0 +1,155 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/async_file.hpp>
+
+#include <cerrno>
+#include <iostream>
+#include <memory>
+#include <nowide/cstdio.hpp>
+#include <nowide/fstream.hpp>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+
+std::string read_file(const std::string& filepath)
+{
+    nowide::ifstream f(filepath, std::ios_base::binary);
+    TEST(f);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+std::string file_content(std::size_t i)
+{
+    return "File " + std::to_string(i) + std::string(i % 300, static_cast<char>('a' + i % 26));
+}
+
+/// Load all files by chaining open, read and close in the callbacks
+void test_batch(nowide::async_file& io, const std::vector<std::string>& filenames)
+{
+    struct loaded_file
+    {
+        int fd = -1;
+        std::vector<char> buffer = std::vector<char>(1024);
+        std::string content;
+        bool closed = false;
+    };
+    std::vector<std::unique_ptr<loaded_file>> files;
+    for(const std::string& filename : filenames)
+    {
+        files.push_back(std::make_unique<loaded_file>());
+        loaded_file& file = *files.back();
+        io.open(filename, std::ios_base::in, [&io, &file](int fd) {
+            TEST(fd >= 0);
+            file.fd = fd;
+            io.read(fd, file.buffer.data(), file.buffer.size(), 0, [&io, &file](int size) {
+                TEST(size >= 0);
+                file.content.assign(file.buffer.data(), static_cast<std::size_t>(size));
+                io.close(file.fd, [&file](int result) {
+                    TEST(result == 0);
+                    file.closed = true;
+                });
+            });
+        });
+    }
+    TEST(io.pending() == filenames.size());
+    io.wait_all();
+    TEST(io.pending() == 0u);
+    for(std::size_t i = 0; i < files.size(); i++)
+    {
+        TEST(files[i]->closed);
+        TEST(files[i]->content == file_content(i));
+    }
+}
+
+void test_futures(nowide::async_file& io, const std::string& filename)
+{
+    std::future<int> fd_future = io.open(filename, std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
+    io.wait_all();
+    const int fd = fd_future.get();
+    TEST(fd >= 0);
+    const std::string data = "Hello World";
+    std::future<int> written1 = io.write(fd, data.data(), 5, 0);
+    std::future<int> written2 = io.write(fd, data.data() + 5, data.size() - 5, 5);
+    TEST(io.wait() > 0);
+    io.wait_all();
+    TEST(written1.get() == 5);
+    TEST(written2.get() == static_cast<int>(data.size() - 5));
+    char buffer[20];
+    std::future<int> read = io.read(fd, buffer, sizeof(buffer), 6);
+    io.wait_all();
+    TEST(read.get() == 5);
+    TEST(std::string(buffer, 5) == "World");
+    std::future<int> closed = io.close(fd);
+    io.wait_all();
+    TEST(closed.get() == 0);
+    TEST(read_file(filename) == data);
+}
+
+void test_errors(nowide::async_file& io, const std::string& filename)
+{
+    std::future<int> missing = io.open(filename + ".missing", std::ios_base::in);
+    std::future<int> invalid_mode = io.open(filename, std::ios_base::in | std::ios_base::trunc);
+    std::future<int> bad_close = io.close(-1);
+    io.wait_all();
+    TEST(missing.get() == -ENOENT);
+    TEST(invalid_mode.get() == -EINVAL);
+    TEST(bad_close.get() == -EBADF);
+    TEST(io.wait() == 0u);
+    TEST(io.poll() == 0u);
+}
+
+void test_main(int, char** argv, char**)
+{
+    const std::string filename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+    std::vector<std::string> filenames;
+    for(std::size_t i = 0; i < 300; i++)
+    {
+        filenames.push_back(filename + "." + std::to_string(i));
+        nowide::ofstream f(filenames.back(), std::ios_base::binary);
+        TEST(f << file_content(i));
+    }
+
+    for(nowide::async_file_backend backend :
+        {nowide::async_file_backend::automatic, nowide::async_file_backend::thread_pool})
+    {
+        for(unsigned queue_depth : {1u, 8u, 256u})
+        {
+            nowide::async_file io(queue_depth, backend);
+            std::cout << "-- " << (io.backend() == nowide::async_file_backend::io_uring ? "io_uring" : "threads")
+                      << " with queue depth " << queue_depth << std::endl;
+            if(backend == nowide::async_file_backend::thread_pool)
+                TEST(io.backend() == nowide::async_file_backend::thread_pool);
+            test_batch(io, filenames);
+            test_futures(io, filename);
+            test_errors(io, filename);
+        }
+    }
+
+    std::cout << "-- Destroying with pending operations" << std::endl;
+    {
+        std::vector<char> buffer(100);
+        int fd;
+        {
+            nowide::async_file io;
+            std::future<int> fd_future = io.open(filenames[5], std::ios_base::in);
+            io.wait_all();
+            fd = fd_future.get();
+            io.read(fd, buffer.data(), buffer.size(), 0, [](int) { TEST(false); });
+            io.submit();
+        }
+        TEST(std::string(buffer.data(), file_content(5).size()) == file_content(5));
+        nowide::async_file io;
+        TEST(io.close(fd).valid());
+    }
+
+    for(const std::string& name : filenames)
+        TEST(nowide::remove(name.c_str()) == 0);
+    TEST(nowide::remove(filename.c_str()) == 0);
+}
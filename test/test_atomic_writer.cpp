@@ -0,0 +1,190 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/atomic_writer.hpp>
+
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <nowide/file_io.hpp>
+#include <string>
+#include <utility>
+#ifndef NOWIDE_WINDOWS
+#include <sys/stat.h>
+#endif
+
+#include "test.hpp"
+
+std::string read_file(const std::string& filepath)
+{
+    std::string content;
+    TEST(nowide::read_file(filepath, content));
+    return content;
+}
+
+std::size_t count_files(const std::string& directory)
+{
+    const nowide::filesystem::path path(directory);
+    return static_cast<std::size_t>(
+      std::distance(std::filesystem::directory_iterator(path), std::filesystem::directory_iterator()));
+}
+
+void test_main(int, char** argv, char**)
+{
+    const std::string directory = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.dir";
+    std::filesystem::remove_all(nowide::filesystem::path(directory));
+    TEST(std::filesystem::create_directory(nowide::filesystem::path(directory)));
+    const std::string filepath = directory + "/file.txt";
+
+    std::cout << "-- Replacing single files" << std::endl;
+    {
+        // New file
+        nowide::atomic_writer writer(filepath);
+        TEST(writer.is_open());
+        TEST(!writer.open(filepath));
+        TEST(writer.write("Hello "));
+        TEST(writer.write("World", 5));
+        TEST(writer.commit());
+        TEST(!writer.is_open());
+        TEST(!writer.write("x"));
+        TEST(!writer.commit());
+        TEST(read_file(filepath) == "Hello World");
+        TEST(count_files(directory) == 1u);
+
+        // Existing file
+        TEST(writer.open(filepath.c_str()));
+        const std::string content(1000000, 'x');
+        TEST(writer.write(content));
+        TEST(read_file(filepath) == "Hello World");
+        TEST(writer.commit());
+        TEST(read_file(filepath) == content);
+        TEST(count_files(directory) == 1u);
+
+        // Empty content
+        TEST(writer.open(nowide::filesystem::path(filepath)));
+        TEST(writer.commit());
+        TEST(read_file(filepath).empty());
+        TEST(count_files(directory) == 1u);
+    }
+    std::cout << "-- Discarding content" << std::endl;
+    {
+        TEST(nowide::write_file(filepath, "old"));
+        {
+            nowide::atomic_writer writer(filepath);
+            TEST(writer.write("new"));
+            writer.abort();
+            TEST(!writer.is_open());
+            TEST(!writer.commit());
+        }
+        {
+            nowide::atomic_writer writer(filepath);
+            TEST(writer.write("new"));
+        }
+        TEST(read_file(filepath) == "old");
+        TEST(count_files(directory) == 1u);
+        nowide::atomic_writer writer(directory + "/missing/file.txt");
+        TEST(!writer.is_open());
+        TEST(!writer.write("new"));
+    }
+    std::cout << "-- Moving" << std::endl;
+    {
+        nowide::atomic_writer writer(filepath);
+        TEST(writer.write("moved"));
+        nowide::atomic_writer other(std::move(writer));
+        TEST(!writer.is_open());
+        TEST(other.is_open());
+        writer = std::move(other);
+        TEST(writer.is_open());
+        TEST(!other.is_open());
+        swap(writer, other);
+        TEST(other.commit());
+        TEST(read_file(filepath) == "moved");
+        TEST(count_files(directory) == 1u);
+    }
+    std::cout << "-- Batches" << std::endl;
+    {
+        const auto name = [&](int i) { return directory + "/file" + std::to_string(i) + ".txt"; };
+        for(int i = 0; i < 10; i += 2)
+            TEST(nowide::write_file(name(i), "old"));
+        {
+            nowide::atomic_batch batch;
+            nowide::atomic_writer writer;
+            TEST(!writer.commit(batch));
+            for(int i = 0; i < 10; i++)
+            {
+                TEST(writer.open(name(i)));
+                TEST(writer.write("new " + std::to_string(i)));
+                TEST(writer.commit(batch));
+                TEST(!writer.is_open());
+            }
+            TEST(batch.size() == 10u);
+            TEST(read_file(name(0)) == "old");
+            TEST(!std::filesystem::exists(nowide::filesystem::path(name(1))));
+            TEST(batch.commit());
+            TEST(batch.empty());
+            for(int i = 0; i < 10; i++)
+                TEST(read_file(name(i)) == "new " + std::to_string(i));
+            TEST(count_files(directory) == 11u);
+            TEST(batch.commit());
+        }
+        {
+            // Discarded with the batch
+            nowide::atomic_batch batch;
+            nowide::atomic_writer writer(name(0));
+            TEST(writer.write("discarded"));
+            TEST(writer.commit(batch));
+            TEST(writer.open(name(1)));
+            TEST(writer.write("discarded"));
+            TEST(writer.commit(batch));
+            TEST(writer.open(name(2)));
+            TEST(writer.write("discarded"));
+            TEST(writer.commit(batch));
+            batch.abort();
+            TEST(batch.empty());
+            TEST(writer.open(name(3)));
+            TEST(writer.write("discarded"));
+            TEST(writer.commit(batch));
+        }
+        for(int i = 0; i < 10; i++)
+            TEST(read_file(name(i)) == "new " + std::to_string(i));
+        TEST(count_files(directory) == 11u);
+    }
+#ifndef NOWIDE_WINDOWS
+    std::cout << "-- Keeping permissions" << std::endl;
+    {
+        const auto mode = [](const std::string& name) {
+            struct stat st;
+            TEST(::stat(name.c_str(), &st) == 0);
+            return st.st_mode & 07777;
+        };
+        TEST(::chmod(filepath.c_str(), 0600) == 0);
+        {
+            nowide::atomic_writer writer(filepath);
+            TEST(writer.write("secret"));
+            TEST(writer.commit());
+        }
+        TEST(mode(filepath) == 0600);
+        TEST(read_file(filepath) == "secret");
+
+        const std::string other = directory + "/file0.txt";
+        TEST(::chmod(other.c_str(), 0640) == 0);
+        nowide::atomic_batch batch;
+        for(const std::string& name : {filepath, other})
+        {
+            nowide::atomic_writer writer(name);
+            TEST(writer.write("batch"));
+            TEST(writer.commit(batch));
+        }
+        TEST(batch.commit());
+        TEST(mode(filepath) == 0600);
+        TEST(mode(other) == 0640);
+        TEST(read_file(other) == "batch");
+    }
+#endif
+    std::filesystem::remove_all(nowide::filesystem::path(directory));
+}
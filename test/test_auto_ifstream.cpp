@@ -0,0 +1,146 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/auto_ifstream.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <nowide/convert.hpp>
+#include <sstream>
+#include <string>
+
+#include "test.hpp"
+
+/// Serialize the code units of \a s with the given byte order
+template<typename CharType>
+std::string to_bytes(const std::basic_string<CharType>& s, bool big_endian)
+{
+    std::string result;
+    for(CharType c : s)
+    {
+        for(std::size_t i = 0; i < sizeof(CharType); i++)
+        {
+            const std::size_t shift = 8 * (big_endian ? sizeof(CharType) - 1 - i : i);
+            result += static_cast<char>((static_cast<std::uint32_t>(c) >> shift) & 0xFF);
+        }
+    }
+    return result;
+}
+
+std::string encode(const std::string& utf8, nowide::text_encoding encoding, bool with_bom)
+{
+    const std::u16string utf16 = nowide::utf::convert_string<char16_t>(utf8.data(), utf8.data() + utf8.size());
+    const std::u32string utf32 = nowide::utf::convert_string<char32_t>(utf8.data(), utf8.data() + utf8.size());
+    switch(encoding)
+    {
+    case nowide::text_encoding::utf8: return (with_bom ? "\xEF\xBB\xBF" : "") + utf8;
+    case nowide::text_encoding::utf16le: return to_bytes((with_bom ? u"\uFEFF" : u"") + utf16, false);
+    case nowide::text_encoding::utf16be: return to_bytes((with_bom ? u"\uFEFF" : u"") + utf16, true);
+    case nowide::text_encoding::utf32le: return to_bytes((with_bom ? U"\uFEFF" : U"") + utf32, false);
+    case nowide::text_encoding::utf32be: return to_bytes((with_bom ? U"\uFEFF" : U"") + utf32, true);
+    }
+    return std::string();
+}
+
+std::string read_all(std::streambuf& buf)
+{
+    std::istream is(&buf);
+    return std::string((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+}
+
+void test_main(int, char**, char**)
+{
+    std::string text;
+    for(int i = 0; i < 200; i++)
+    {
+        text += "Line \xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d \xE3\x82\x84 \xf0\x9f\x98\x80 number ";
+        text += std::to_string(i) + "\n";
+    }
+    const nowide::text_encoding encodings[] = {nowide::text_encoding::utf8,
+                                               nowide::text_encoding::utf16le,
+                                               nowide::text_encoding::utf16be,
+                                               nowide::text_encoding::utf32le,
+                                               nowide::text_encoding::utf32be};
+
+    {
+        std::cout << "-- Detection and decoding" << std::endl;
+        for(nowide::text_encoding encoding : encodings)
+        {
+            for(bool with_bom : {true, false})
+            {
+                const std::string bytes = encode(text, encoding, with_bom);
+                std::size_t bom_length;
+                TEST(nowide::detect_encoding(bytes.data(), bytes.data() + bytes.size(), bom_length) == encoding);
+                TEST(bom_length == (with_bom ? encode("", encoding, true).size() : 0u));
+                for(std::size_t block_size : {1, 17, 100, 4096, 100000})
+                {
+                    std::stringbuf raw(bytes);
+                    nowide::auto_decoding_streambuf buf(&raw, block_size);
+                    TEST(buf.encoding() == encoding);
+                    TEST(read_all(buf) == text);
+                }
+            }
+        }
+    }
+    {
+        std::cout << "-- CR LF line endings" << std::endl;
+        std::string crlf_text;
+        for(std::size_t pos = 0; pos < text.size(); pos = text.find('\n', pos) + 1)
+            crlf_text += text.substr(pos, text.find('\n', pos) - pos) + "\r\n";
+        for(nowide::text_encoding encoding : encodings)
+        {
+            const std::string bytes = encode(crlf_text, encoding, true);
+            for(std::size_t block_size : {1, 17, 4096})
+            {
+                std::stringbuf raw(bytes);
+                nowide::auto_decoding_streambuf buf(&raw, block_size);
+                TEST(!buf.crlf());
+                buf.crlf(true);
+                TEST(read_all(buf) == text);
+            }
+        }
+    }
+    {
+        std::cout << "-- Invalid and truncated input" << std::endl;
+        const std::string replacement = "\xEF\xBF\xBD";
+        std::stringbuf raw(encode("ab", nowide::text_encoding::utf16be, true) + "\xD8\x3D" + "x");
+        nowide::auto_decoding_streambuf buf(&raw);
+        // Unpaired surrogate and an incomplete code unit
+        TEST(read_all(buf) == "ab" + replacement + replacement);
+        std::stringbuf raw2("a\xFF");
+        TEST(buf.rdbuf(&raw2) == &raw);
+        TEST(read_all(buf) == "a" + replacement);
+        TEST(buf.encoding() == nowide::text_encoding::utf8);
+        std::stringbuf empty;
+        buf.rdbuf(&empty);
+        TEST(read_all(buf).empty());
+        TEST(buf.encoding() == nowide::text_encoding::utf8);
+    }
+    {
+        std::cout << "-- auto_ifstream" << std::endl;
+        const std::string filename = "nowide-test_auto_ifstream.txt";
+        {
+            std::ofstream f(filename.c_str(), std::ios::binary);
+            f << encode(text, nowide::text_encoding::utf16be, true);
+        }
+        nowide::auto_ifstream f(filename);
+        TEST(f.is_open());
+        TEST(f.encoding() == nowide::text_encoding::utf16be);
+        std::string line;
+        TEST(std::getline(f, line));
+        TEST(line + "\n" == text.substr(0, text.find('\n') + 1));
+        f.close();
+        TEST(!f.is_open());
+        std::remove(filename.c_str());
+        nowide::auto_ifstream missing(filename);
+        TEST(!missing);
+    }
+}
@@ -8,7 +8,9 @@
 
 #include <nowide/utf8_codecvt.hpp>
 
+#include <algorithm>
 #include <cstring>
+#include <cwchar>
 #include <iomanip>
 #include <iostream>
 #include <locale>
@@ -316,9 +318,225 @@ void test_codecvt_subst()
     run_all(codecvt_to_wide, codecvt_to_narrow);
 }
 
+/// Text with long ASCII runs, multi-byte runs of all lengths and invalid sequences
+std::string make_mixed_utf8(std::size_t min_size)
+{
+    const char* const parts[] = {"Hello World, this is a longer ASCII run to be copied as a block. ",
+                                 "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d",
+                                 "\xE3\x82\x84\xE3\x81\x82\xE3\x82\x84",
+                                 "\xf0\x9d\x92\x9e\xf0\x9f\x98\x80",
+                                 "a",
+                                 "\xFF",
+                                 "\xE3\x82",
+                                 "\r\n"};
+    std::string result;
+    for(std::size_t i = 0; result.size() < min_size; i++)
+        result += parts[(i * 7 + i / 3) % (sizeof(parts) / sizeof(parts[0]))];
+    return result;
+}
+
+template<typename CharType>
+void test_codecvt_bulk_in_out(const std::string& utf8, std::size_t in_chunk, std::size_t out_chunk)
+{
+    using facet_type = std::codecvt<CharType, char, std::mbstate_t>;
+    const std::locale l(std::locale::classic(), new nowide::utf8_codecvt<CharType>());
+    const facet_type& cvt = std::use_facet<facet_type>(l);
+    const std::basic_string<CharType> expected =
+      nowide::utf::convert_string<CharType>(utf8.data(), utf8.data() + utf8.size());
+
+    std::basic_string<CharType> wide;
+    {
+        std::mbstate_t mb{};
+        std::vector<CharType> buf(out_chunk);
+        const char* from = utf8.data();
+        const char* const real_end = from + utf8.size();
+        while(from != real_end)
+        {
+            const char* from_end = from + std::min<std::size_t>(in_chunk, real_end - from);
+            const char* from_next;
+            CharType* to_next;
+            std::mbstate_t mb2 = mb;
+            typename facet_type::result r =
+              cvt.in(mb, from, from_end, from_next, buf.data(), buf.data() + buf.size(), to_next);
+            TEST(cvt.length(mb2, from, from_end, buf.size()) == from_next - from);
+            TEST(std::memcmp(&mb, &mb2, sizeof(mb)) == 0);
+            if(r == facet_type::partial && from_next == from && to_next == buf.data())
+            {
+                // Need more input for a complete sequence
+                TEST(from_end != real_end);
+                in_chunk++;
+                continue;
+            }
+            TEST(r == facet_type::ok || r == facet_type::partial);
+            wide.append(buf.data(), to_next);
+            from = from_next;
+        }
+    }
+    TEST(wide == expected);
+
+    std::string narrow;
+    {
+        std::mbstate_t mb{};
+        std::vector<char> buf(std::max<std::size_t>(out_chunk, 4));
+        const CharType* from = expected.data();
+        const CharType* const real_end = from + expected.size();
+        while(from != real_end)
+        {
+            const CharType* from_end = from + std::min<std::size_t>(in_chunk, real_end - from);
+            const CharType* from_next;
+            char* to_next;
+            typename facet_type::result r =
+              cvt.out(mb, from, from_end, from_next, buf.data(), buf.data() + buf.size(), to_next);
+            TEST(r == facet_type::ok || r == facet_type::partial);
+            narrow.append(buf.data(), to_next);
+            from = from_next;
+        }
+    }
+    TEST(narrow == nowide::utf::convert_string<char>(expected.data(), expected.data() + expected.size()));
+}
+
+void test_codecvt_bulk()
+{
+    std::cout << "Bulk conversions" << std::endl;
+    const std::string utf8 = make_mixed_utf8(20000);
+    const std::size_t sizes[] = {1, 2, 3, 5, 17, 64, 1000, 8192, 100000};
+    for(std::size_t in_chunk : sizes)
+    {
+        for(std::size_t out_chunk : sizes)
+        {
+            try
+            {
+                test_codecvt_bulk_in_out<char16_t>(utf8, in_chunk, out_chunk);
+                test_codecvt_bulk_in_out<char32_t>(utf8, in_chunk, out_chunk);
+                test_codecvt_bulk_in_out<wchar_t>(utf8, in_chunk, out_chunk);
+            } catch(...)
+            {
+                std::cerr << "In=" << in_chunk << " Out=" << out_chunk << std::endl;
+                throw;
+            }
+        }
+    }
+}
+
+template<typename CharType>
+void test_codecvt_length(const std::string& utf8)
+{
+    using facet_type = std::codecvt<CharType, char, std::mbstate_t>;
+    const std::locale l(std::locale::classic(), new nowide::utf8_codecvt<CharType>());
+    const facet_type& cvt = std::use_facet<facet_type>(l);
+    std::vector<CharType> buf(utf8.size() + 1);
+    const std::size_t max_sizes[] = {1, 2, 31, 32, 33, 100, buf.size()};
+    for(std::size_t max : max_sizes)
+    {
+        for(std::size_t offset = 0; offset < 20 && offset < utf8.size(); offset++)
+        {
+            const char* from = utf8.data() + offset;
+            const char* const from_end = utf8.data() + utf8.size();
+            std::mbstate_t mb{};
+            std::mbstate_t mb2{};
+            const char* from_next;
+            CharType* to_next;
+            cvt.in(mb, from, from_end, from_next, buf.data(), buf.data() + max, to_next);
+            TEST(cvt.length(mb2, from, from_end, max) == from_next - from);
+            TEST(std::memcmp(&mb, &mb2, sizeof(mb)) == 0);
+        }
+    }
+}
+
+void test_codecvt_length()
+{
+    std::cout << "Length" << std::endl;
+    // Valid and invalid sequences which are checked differently by the block kernels
+    const char* const parts[] = {"abcdefgh",
+                                 "\xd7\xa9",
+                                 "\xE3\x82\x84",
+                                 "\xf0\x9f\x98\x80",
+                                 "\xf4\x8f\xbf\xbf",
+                                 "\xef\xbf\xbf",
+                                 "\xC0\x80",
+                                 "\xC1\xBF",
+                                 "\xE0\x80\x80",
+                                 "\xE0\xA0\x80",
+                                 "\xED\xA0\x80",
+                                 "\xED\x9F\xBF",
+                                 "\xF0\x80\x80\x80",
+                                 "\xF0\x90\x80\x80",
+                                 "\xF4\x90\x80\x80",
+                                 "\xF5\x80\x80\x80",
+                                 "\xFF",
+                                 "\x80",
+                                 "\xE3\x82",
+                                 "\xf0\x9f\x98"};
+    const std::size_t num_parts = sizeof(parts) / sizeof(parts[0]);
+    std::string valid;
+    for(std::size_t i = 0; valid.size() < 1000; i++)
+        valid += parts[i % 6];
+    test_codecvt_length<char16_t>(valid);
+    test_codecvt_length<char32_t>(valid);
+    for(std::size_t i = 0; i < num_parts; i++)
+    {
+        for(std::size_t pos = 0; pos < 40; pos += 3)
+        {
+            // Put each part at different positions relative to the blocks
+            std::string s = valid.substr(0, 200);
+            s.insert(pos + 30, parts[i]);
+            test_codecvt_length<char16_t>(s);
+            test_codecvt_length<char32_t>(s);
+        }
+    }
+}
+
+void test_codecvt_surrogates()
+{
+    std::cout << "Surrogate pairs" << std::endl;
+    using facet_type = std::codecvt<char16_t, char, std::mbstate_t>;
+    const std::locale l(std::locale::classic(), new nowide::utf8_codecvt<char16_t>());
+    const facet_type& cvt = std::use_facet<facet_type>(l);
+    // U+1F600 followed by an incomplete sequence, so the state machine handles the pair
+    const char input[] = "\xf0\x9f\x98\x80\xf0\x9f";
+    const char* const input_end = input + 6;
+    const char* from_next;
+    char16_t buf[4];
+    char16_t* to_next;
+    {
+        // Both surrogates written in one step
+        std::mbstate_t mb{};
+        std::mbstate_t mb2{};
+        TEST(cvt.in(mb, input, input_end, from_next, buf, buf + 2, to_next) == facet_type::partial);
+        TEST(from_next == input + 4);
+        TEST(to_next == buf + 2);
+        TEST(buf[0] == 0xD83D && buf[1] == 0xDE00);
+        TEST(std::mbsinit(&mb));
+        TEST(cvt.length(mb2, input, input_end, 2) == 4);
+        TEST(std::mbsinit(&mb2));
+    }
+    {
+        // Single output slot: The state carries the second surrogate
+        std::mbstate_t mb{};
+        std::mbstate_t mb2{};
+        TEST(cvt.in(mb, input, input_end, from_next, buf, buf + 1, to_next) == facet_type::partial);
+        TEST(from_next == input);
+        TEST(to_next == buf + 1);
+        TEST(buf[0] == 0xD83D);
+        TEST(!std::mbsinit(&mb));
+        TEST(cvt.length(mb2, input, input_end, 1) == 0);
+        TEST(std::memcmp(&mb, &mb2, sizeof(mb)) == 0);
+        TEST(cvt.in(mb, input, input_end, from_next, buf, buf + 4, to_next) == facet_type::partial);
+        TEST(from_next == input + 4);
+        TEST(to_next == buf + 1);
+        TEST(buf[0] == 0xDE00);
+        TEST(std::mbsinit(&mb));
+        TEST(cvt.length(mb2, input, input_end, 4) == 4);
+        TEST(std::mbsinit(&mb2));
+    }
+}
+
 void test_main(int, char**, char**)
 {
     test_codecvt_conv();
     test_codecvt_err();
     test_codecvt_subst();
+    test_codecvt_bulk();
+    test_codecvt_surrogates();
+    test_codecvt_length();
 }
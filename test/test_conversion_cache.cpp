@@ -0,0 +1,102 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/conversion_cache.hpp>
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+#include "test_sets.hpp"
+
+nowide::conversion_cache<wchar_t, char> wide_cache(64, 4);
+nowide::conversion_cache<char, wchar_t> narrow_cache(64, 4);
+
+std::wstring cache_to_wide(const std::string& s)
+{
+    const auto first = wide_cache.get(s);
+    TEST(wide_cache.get(s) == first);
+    return *first;
+}
+
+std::string cache_to_narrow(const std::wstring& s)
+{
+    const auto first = narrow_cache.get(s);
+    TEST(narrow_cache.get(s) == first);
+    return *first;
+}
+
+void test_main(int, char**, char**)
+{
+    const std::string hello = "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d";
+    const std::wstring whello = nowide::widen(hello);
+
+    {
+        std::cout << "-- Hits and misses are counted" << std::endl;
+        nowide::wconversion_cache cache(8, 2);
+        TEST(cache.capacity() == 8u);
+        TEST(cache.size() == 0u);
+        const auto value = cache.get(hello);
+        TEST(*value == whello);
+        TEST(cache.misses() == 1u);
+        TEST(cache.hits() == 0u);
+        TEST(cache.get(hello.c_str()) == value);
+        TEST(cache.get(std::string_view(hello)) == value);
+        TEST(cache.misses() == 1u);
+        TEST(cache.hits() == 2u);
+        TEST(cache.size() == 1u);
+        cache.clear();
+        TEST(cache.size() == 0u);
+        TEST(*value == whello);
+        TEST(cache.get(hello) != value);
+        TEST(cache.misses() == 2u);
+    }
+    {
+        std::cout << "-- Least recently used strings are evicted" << std::endl;
+        nowide::wconversion_cache cache(3, 1);
+        const auto a = cache.get("a");
+        cache.get("b");
+        cache.get("c");
+        TEST(cache.get("a") == a); // a is now most recently used
+        cache.get("d");            // evicts b
+        TEST(cache.size() == 3u);
+        TEST(cache.get("a") == a);
+        const std::size_t misses = cache.misses();
+        cache.get("c");
+        TEST(cache.misses() == misses);
+        cache.get("b");
+        TEST(cache.misses() == misses + 1);
+        TEST(*a == L"a");
+    }
+    {
+        std::cout << "-- Concurrent use" << std::endl;
+        nowide::wconversion_cache cache(100, 8);
+        std::vector<std::string> keys;
+        for(int i = 0; i < 50; i++)
+            keys.push_back(hello + std::to_string(i));
+        std::vector<std::thread> threads;
+        for(int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&]() {
+                for(int round = 0; round < 100; round++)
+                {
+                    for(const std::string& key : keys)
+                        TEST(*cache.get(key) == nowide::widen(key));
+                }
+            });
+        }
+        for(std::thread& t : threads)
+            t.join();
+        TEST(cache.hits() + cache.misses() == 4u * 100u * keys.size());
+        TEST(cache.size() <= cache.capacity());
+    }
+    std::cout << "- Conversion cache" << std::endl;
+    run_all(cache_to_wide, cache_to_narrow);
+}
@@ -8,6 +8,8 @@
 
 #include <iostream>
 #include <nowide/convert.hpp>
+#include <nowide/utf/endian.hpp>
+#include <vector>
 
 #include "test.hpp"
 #include "test_sets.hpp"
@@ -88,6 +90,61 @@ std::string narrow_string_view(const std::wstring& s)
     return nowide::narrow(std::wstring_view(s));
 }
 
+std::string replace_all(std::string s, const std::string& from, const std::string& to)
+{
+    for(std::size_t pos = s.find(from); pos != std::string::npos; pos = s.find(from, pos + to.size()))
+        s.replace(pos, from.size(), to);
+    return s;
+}
+
+template<typename CharOut, typename CharIn>
+std::basic_string<CharOut> convert_newlines(const std::string& utf8, nowide::utf::newline_conversion newlines)
+{
+    const std::vector<CharIn> input = [&utf8] {
+        std::vector<CharIn> result(utf8.size());
+        CharIn* to = result.data();
+        const char* from = utf8.data();
+        TEST(nowide::utf::convert_prefix(to, to + result.size(), from, from + utf8.size()));
+        result.resize(to - result.data());
+        return result;
+    }();
+    std::vector<CharOut> output(input.size() * 2 * nowide::utf::utf_traits<CharOut>::max_width);
+    CharOut* to = output.data();
+    const CharIn* from = input.data();
+    TEST(nowide::utf::convert_prefix(to, to + output.size(), from, from + input.size(), newlines));
+    TEST(from == input.data() + input.size());
+    std::basic_string<CharOut> result;
+    for(const CharOut* p = output.data(); p != to; ++p)
+        result += static_cast<CharOut>(*p);
+    return result;
+}
+
+template<typename CharOut, typename CharIn>
+void test_newlines(const std::string& utf8)
+{
+    using nowide::utf::newline_conversion;
+    const auto expected = [](const std::string& s) {
+        return nowide::utf::convert_string<CharOut>(s.data(), s.data() + s.size());
+    };
+    TEST((convert_newlines<CharOut, CharIn>(utf8, newline_conversion::none)) == expected(utf8));
+    TEST((convert_newlines<CharOut, CharIn>(utf8, newline_conversion::crlf_to_lf))
+         == expected(replace_all(utf8, "\r\n", "\n")));
+    TEST((convert_newlines<CharOut, CharIn>(utf8, newline_conversion::lf_to_crlf))
+         == expected(replace_all(utf8, "\n", "\r\n")));
+}
+
+void test_newlines(const std::string& utf8)
+{
+    test_newlines<char, char>(utf8);
+    test_newlines<wchar_t, char>(utf8);
+    test_newlines<char16_t, char>(utf8);
+    test_newlines<char32_t, char>(utf8);
+    test_newlines<char, char16_t>(utf8);
+    test_newlines<char, char32_t>(utf8);
+    test_newlines<char16_t, nowide::utf::be16>(utf8);
+    test_newlines<char32_t, nowide::utf::le32>(utf8);
+}
+
 void test_main(int, char**, char**)
 {
     std::string hello = "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d";
@@ -137,4 +194,40 @@ void test_main(int, char**, char**)
     run_all(widen_convert, narrow_convert);
     std::cout << "- (std::string_view)" << std::endl;
     run_all(widen_string_view, narrow_string_view);
+
+    std::cout << "- Newline conversion" << std::endl;
+    {
+        test_newlines("");
+        test_newlines("\r");
+        test_newlines("\n\r\n\r\r\n\n\r");
+        test_newlines("a\r\xd7\xa9\r\n\xd7\xa9\n\xf0\x9f\x98\x80\r");
+        // Newlines at all positions of the blocks
+        for(std::size_t pos = 0; pos < 40; pos++)
+        {
+            std::string text(70, 'a');
+            text.insert(pos, "\r\n");
+            text.insert(pos + 20, "\n");
+            text.insert(pos / 2, "\r");
+            test_newlines(text);
+        }
+
+        using nowide::utf::newline_conversion;
+        // The CR LF is not split if the output is full
+        const std::string input = "ab\ncd";
+        char buf[3];
+        char* to = buf;
+        const char* from = input.data();
+        TEST(!nowide::utf::convert_prefix(to, buf + 3, from, from + input.size(), newline_conversion::lf_to_crlf));
+        TEST(to == buf + 2 && from == input.data() + 2);
+        // A trailing CR is kept for the next block
+        const std::string cr = "ab\r";
+        const char* cr_end = cr.data() + cr.size();
+        TEST(nowide::utf::complete_sequences_end(cr.data(), cr_end, newline_conversion::crlf_to_lf) == cr_end - 1);
+        TEST(nowide::utf::complete_sequences_end(cr.data(), cr_end) == cr_end);
+        const std::string cr_incomplete = "ab\r\xd7";
+        TEST(nowide::utf::complete_sequences_end(cr_incomplete.data(),
+                                                 cr_incomplete.data() + cr_incomplete.size(),
+                                                 newline_conversion::crlf_to_lf)
+             == cr_incomplete.data() + 2);
+    }
 }
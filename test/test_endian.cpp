@@ -0,0 +1,145 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/utf/endian.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <nowide/utf/convert.hpp>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+
+/// Serialize the code units of \a str with the given byte order
+template<typename CharType>
+std::string serialize(const std::basic_string<CharType>& str, bool big_endian)
+{
+    std::string result;
+    for(CharType c : str)
+    {
+        for(std::size_t i = 0; i < sizeof(CharType); i++)
+        {
+            const std::size_t shift = 8 * (big_endian ? sizeof(CharType) - 1 - i : i);
+            result += static_cast<char>((static_cast<std::uint32_t>(c) >> shift) & 0xFF);
+        }
+    }
+    return result;
+}
+
+/// Convert \a str to code units \tparam EndianUnit and return their bytes
+template<typename EndianUnit, typename CharIn>
+std::string to_endian(const std::basic_string<CharIn>& str)
+{
+    std::vector<EndianUnit> buffer(str.size() * nowide::utf::utf_traits<EndianUnit>::max_width + 1);
+    EndianUnit* to = buffer.data();
+    const CharIn* from = str.data();
+    TEST(nowide::utf::convert_prefix(to, buffer.data() + buffer.size(), from, from + str.size()));
+    return std::string(reinterpret_cast<const char*>(buffer.data()), (to - buffer.data()) * sizeof(EndianUnit));
+}
+
+/// Convert the bytes \a bytes, which are code units \tparam EndianUnit, to \tparam CharOut
+template<typename CharOut, typename EndianUnit>
+std::basic_string<CharOut> from_endian(const std::string& bytes)
+{
+    const EndianUnit* const begin = reinterpret_cast<const EndianUnit*>(bytes.data());
+    return nowide::utf::convert_string<CharOut>(begin, begin + bytes.size() / sizeof(EndianUnit));
+}
+
+template<typename EndianUnit, typename Native>
+void test_round_trip(const std::string& utf8, const std::basic_string<Native>& native, bool big_endian)
+{
+    const std::string bytes = serialize(native, big_endian);
+    TEST(to_endian<EndianUnit>(utf8) == bytes);
+    TEST(to_endian<EndianUnit>(native) == bytes);
+    TEST((from_endian<char, EndianUnit>(bytes)) == utf8);
+    TEST((from_endian<Native, EndianUnit>(bytes)) == native);
+}
+
+void test_text(const std::string& utf8)
+{
+    const std::u16string utf16 = nowide::utf::convert_string<char16_t>(utf8.data(), utf8.data() + utf8.size());
+    const std::u32string utf32 = nowide::utf::convert_string<char32_t>(utf8.data(), utf8.data() + utf8.size());
+    test_round_trip<nowide::utf::be16>(utf8, utf16, true);
+    test_round_trip<nowide::utf::le16>(utf8, utf16, false);
+    test_round_trip<nowide::utf::be32>(utf8, utf32, true);
+    test_round_trip<nowide::utf::le32>(utf8, utf32, false);
+    // Between different byte orders
+    const std::string be16_bytes = serialize(utf16, true);
+    const std::string le32_bytes = serialize(utf32, false);
+    const std::u16string utf16_from_be = from_endian<char16_t, nowide::utf::be16>(be16_bytes);
+    TEST(to_endian<nowide::utf::le32>(utf16_from_be) == le32_bytes);
+    const nowide::utf::le32* const le32_begin = reinterpret_cast<const nowide::utf::le32*>(le32_bytes.data());
+    std::vector<nowide::utf::be16> be16_buffer(utf16.size() + 1);
+    nowide::utf::be16* to = be16_buffer.data();
+    const nowide::utf::le32* from = le32_begin;
+    TEST(nowide::utf::convert_prefix(to, to + be16_buffer.size(), from, le32_begin + utf32.size()));
+    TEST(std::string(reinterpret_cast<const char*>(be16_buffer.data()), (to - be16_buffer.data()) * 2) == be16_bytes);
+}
+
+void test_main(int, char**, char**)
+{
+    std::cout << "-- Layout and value access" << std::endl;
+    {
+        static_assert(sizeof(nowide::utf::be16) == 2 && alignof(nowide::utf::be16) == 1);
+        static_assert(sizeof(nowide::utf::le32) == 4 && alignof(nowide::utf::le32) == 1);
+        static_assert(nowide::utf::is_endian_unit<nowide::utf::be32>::value);
+        static_assert(!nowide::utf::is_endian_unit<char32_t>::value);
+        const nowide::utf::be16 be = u'\u05e9';
+        const nowide::utf::le16 le = u'\u05e9';
+        TEST(std::memcmp(&be, "\x05\xe9", 2) == 0);
+        TEST(std::memcmp(&le, "\xe9\x05", 2) == 0);
+        TEST(char16_t(be) == u'\u05e9');
+        const nowide::utf::be32 be32 = U'\U0001F600';
+        TEST(std::memcmp(&be32, "\0\x01\xf6\x00", 4) == 0);
+        TEST(char32_t(be32) == U'\U0001F600');
+    }
+    std::cout << "-- utf_traits" << std::endl;
+    {
+        using traits = nowide::utf::utf_traits<nowide::utf::be16>;
+        const std::string bytes = serialize(std::u16string(u"\U0001F600"), true);
+        const nowide::utf::be16* p = reinterpret_cast<const nowide::utf::be16*>(bytes.data());
+        TEST(traits::decode(p, p + 2) == 0x1F600);
+        nowide::utf::be16 encoded[2];
+        TEST(traits::encode(0x1F600, encoded) == encoded + 2);
+        TEST(std::memcmp(encoded, bytes.data(), 4) == 0);
+        // A lone surrogate
+        const std::string lone = serialize(std::u16string(1, char16_t(0xD800)), true);
+        p = reinterpret_cast<const nowide::utf::be16*>(lone.data());
+        TEST(traits::decode(p, p + 1) == nowide::utf::incomplete);
+    }
+    std::cout << "-- Conversion" << std::endl;
+    {
+        test_text("");
+        test_text("Hello World");
+        test_text("\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d \xf0\x9f\x98\x80");
+        // Long ASCII runs crossing vector blocks at all offsets
+        for(std::size_t prefix = 0; prefix < 20; prefix++)
+        {
+            std::string text(prefix, 'x');
+            text += "\xd7\xa9";
+            text += std::string(70, 'a');
+            // U+0100 and U+0200 have an ASCII byte in the other byte order
+            text += "\xc4\x80" "abcdefgh" "\xc8\x80";
+            text += "\xf0\x9f\x98\x80";
+            text += std::string(33, 'z');
+            test_text(text);
+        }
+    }
+    std::cout << "-- Invalid input" << std::endl;
+    {
+        // Unpaired surrogate followed by ASCII is replaced
+        const std::u16string input = u"ab" + std::u16string(1, char16_t(0xDC00)) + u"cdefghijklmnopqrstuvwxyz";
+        const std::string bytes = serialize(input, true);
+        const std::string expected = "ab\xef\xbf\xbd" "cdefghijklmnopqrstuvwxyz";
+        TEST((from_endian<char, nowide::utf::be16>(bytes)) == expected);
+        const std::u32string too_big = std::u32string(1, char32_t(0x110000)) + U"abcdefghijklmnopqrstuvwxyz";
+        const std::string too_big_bytes = serialize(too_big, false);
+        TEST((from_endian<char, nowide::utf::le32>(too_big_bytes)) == "\xef\xbf\xbd" "abcdefghijklmnopqrstuvwxyz");
+    }
+}
@@ -0,0 +1,486 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/fd_filebuf.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <nowide/cstdio.hpp>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+
+std::string read_file(const char* filepath)
+{
+    FILE* f = nowide::fopen(filepath, "rb");
+    TEST(f);
+    std::string content;
+    int c;
+    while((c = std::fgetc(f)) != EOF)
+        content.push_back(static_cast<char>(c));
+    std::fclose(f);
+    return content;
+}
+
+std::string make_data(std::size_t size)
+{
+    std::string result(size, '\0');
+    for(std::size_t i = 0; i < size; i++)
+        result[i] = static_cast<char>('a' + (i * 7 + i / 251) % 26);
+    return result;
+}
+
+void test_main(int, char** argv, char**)
+{
+    const std::string filename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+    const char* const filepath = filename.c_str();
+    // Left over from a failed run
+    nowide::remove(filepath);
+
+    std::cout << "-- Open modes" << std::endl;
+    {
+        nowide::fd_filebuf buf;
+        TEST(!buf.is_open());
+        TEST(buf.fd() == -1);
+        TEST(buf.buffer_size() == nowide::fd_filebuf::default_buffer_size);
+        TEST(!buf.open(filepath, std::ios_base::in));
+        TEST(!buf.open(filepath, std::ios_base::in | std::ios_base::trunc));
+        TEST(!buf.open(filepath, std::ios_base::trunc));
+        TEST(buf.open(filepath, std::ios_base::out) == &buf);
+        TEST(buf.fd() >= 0);
+        TEST(!buf.open(filepath, std::ios_base::out));
+        TEST(buf.sputn("abc", 3) == 3);
+        TEST(buf.sgetc() == EOF);
+        TEST(buf.close() == &buf);
+        TEST(!buf.close());
+        TEST(buf.open(filepath, std::ios_base::app) == &buf);
+        TEST(buf.sputn("def", 3) == 3);
+        TEST(buf.close() == &buf);
+        TEST(read_file(filepath) == "abcdef");
+        TEST(buf.open(filepath, std::ios_base::in | std::ios_base::ate) == &buf);
+        TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(6));
+        TEST(buf.sputc('x') == EOF);
+        TEST(buf.pubseekpos(2) == std::streampos(2));
+        TEST(buf.sgetc() == 'c');
+        TEST(buf.close() == &buf);
+    }
+    std::cout << "-- Large buffers and direct reads and writes" << std::endl;
+    for(std::size_t buffer_size : {std::size_t(1), std::size_t(16), std::size_t(4) << 20})
+    {
+        const std::string data = make_data(5 << 20);
+        {
+            nowide::fd_filebuf buf;
+            buf.buffer_size(buffer_size);
+            TEST(buf.buffer_size() == buffer_size);
+            TEST(buf.open(filepath, std::ios_base::out | std::ios_base::binary) == &buf);
+            // Small and large writes mixed
+            std::size_t pos = 0;
+            for(std::size_t size = 1; pos < data.size(); size = size * 3 + 1)
+            {
+                const std::size_t count = std::min(size % 100000, data.size() - pos);
+                TEST(buf.sputn(data.data() + pos, static_cast<std::streamsize>(count))
+                     == static_cast<std::streamsize>(count));
+                pos += count;
+            }
+        }
+        TEST(read_file(filepath) == data);
+        {
+            nowide::fd_filebuf buf;
+            buf.buffer_size(buffer_size);
+            TEST(buf.open(filepath, std::ios_base::in | std::ios_base::binary) == &buf);
+            std::string result(data.size() + 10, '\0');
+            std::size_t pos = 0;
+            for(std::size_t size = 1; pos < data.size(); size = size * 5 + 3)
+            {
+                const std::size_t count = std::min(size % 300000, data.size() - pos);
+                const std::streamsize read = buf.sgetn(&result[pos], static_cast<std::streamsize>(count));
+                TEST(read == static_cast<std::streamsize>(count));
+                pos += count;
+            }
+            TEST(buf.sgetn(&result[pos], 10) == 0);
+            result.resize(pos);
+            TEST(result == data);
+        }
+    }
+    std::cout << "-- Bypassed writes keep the order of buffered output" << std::endl;
+    {
+        const std::string data = make_data(100);
+        nowide::fd_filebuf buf;
+        buf.buffer_size(16);
+        TEST(buf.open(filepath, std::ios_base::in | std::ios_base::out | std::ios_base::trunc) == &buf);
+        TEST(buf.sputn("0123", 4) == 4);
+        TEST(read_file(filepath).empty());
+        TEST(buf.sputn(data.data(), 100) == 100);
+        // Written without flushing
+        TEST(read_file(filepath) == "0123" + data);
+        TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(104));
+        // Read a bit, then bypass the buffer from the middle of the get area
+        TEST(buf.pubseekpos(2) == std::streampos(2));
+        TEST(buf.sbumpc() == '2');
+        std::string result(50, '\0');
+        TEST(buf.sgetn(&result[0], 50) == 50);
+        TEST(result == "3" + data.substr(0, 49));
+        TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(53));
+        // Switch to writing after a direct read
+        TEST(buf.sputc('X') == 'X');
+        TEST(buf.pubsync() == 0);
+        TEST(read_file(filepath).substr(52, 3) == data.substr(48, 1) + "X" + data.substr(50, 1));
+    }
+    std::cout << "-- Gathered writes and statistics" << std::endl;
+    {
+#ifdef NOWIDE_WINDOWS
+        // No gathering write, buffered output and the data are written separately
+        const std::uint64_t calls_per_gather = 2;
+#else
+        const std::uint64_t calls_per_gather = 1;
+#endif
+        const std::string header = make_data(40);
+        const std::string payload = make_data(64 * 1024);
+        std::string expected;
+        {
+            nowide::fd_filebuf buf;
+            TEST(buf.open(filepath, std::ios_base::out | std::ios_base::binary) == &buf);
+            for(int i = 0; i < 100; i++)
+            {
+                TEST(buf.sputn(header.data(), 40) == 40);
+                TEST(buf.sputn(payload.data(), 64 * 1024) == 64 * 1024);
+                expected += header + payload;
+            }
+            // Each header is written together with its payload
+            const nowide::fd_filebuf::io_statistics& stats = buf.statistics();
+            TEST(stats.write_calls == 100 * calls_per_gather);
+            TEST(stats.bytes_written == expected.size());
+            TEST(stats.bytes_bypassed == 100 * payload.size());
+            TEST(stats.read_calls == 0);
+            TEST(stats.seek_calls == 0);
+            // Medium writes are gathered, small ones copied
+            buf.reset_statistics();
+            TEST(buf.statistics().write_calls == 0);
+            buf.buffer_size(1024);
+            for(int i = 0; i < 8; i++)
+            {
+                TEST(buf.sputn(payload.data(), 300) == 300);
+                expected += payload.substr(0, 300);
+            }
+            TEST(buf.statistics().write_calls == 2 * calls_per_gather);
+            TEST(buf.statistics().bytes_bypassed == 2 * 300);
+            buf.reset_statistics();
+            for(int i = 0; i < 21; i++)
+            {
+                TEST(buf.sputn(header.data(), 40) == 40);
+                expected += header;
+            }
+            TEST(buf.statistics().write_calls == 0);
+            for(int i = 0; i < 5; i++)
+            {
+                TEST(buf.sputn(header.data(), 40) == 40);
+                expected += header;
+            }
+            TEST(buf.statistics().write_calls == 1);
+            TEST(buf.statistics().bytes_written == 1024);
+            TEST(buf.statistics().bytes_bypassed == 0);
+        }
+        TEST(read_file(filepath) == expected);
+        nowide::fd_filebuf buf;
+        buf.buffer_size(1000);
+        TEST(buf.open(filepath, std::ios_base::in | std::ios_base::binary) == &buf);
+        std::string result(expected.size(), '\0');
+        TEST(buf.sgetn(&result[0], 500) == 500);
+        TEST(buf.statistics().read_calls == 1);
+        TEST(buf.statistics().bytes_read == 1000);
+        TEST(buf.sgetn(&result[500], static_cast<std::streamsize>(expected.size() - 500))
+             == static_cast<std::streamsize>(expected.size() - 500));
+        TEST(result == expected);
+        TEST(buf.statistics().bytes_read == expected.size());
+        TEST(buf.statistics().bytes_bypassed == expected.size() - 1000);
+        TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(static_cast<std::streamoff>(expected.size())));
+        TEST(buf.statistics().seek_calls == 1);
+    }
+    std::cout << "-- Direct I/O" << std::endl;
+    {
+        const std::size_t alignment = nowide::fd_filebuf::direct_io_alignment;
+        const std::string data = make_data(1000003);
+        {
+            nowide::fd_ofstream f(filepath, std::ios_base::out, nowide::file_options::direct_io);
+            TEST(f);
+            std::cout << "Direct I/O supported: " << f.rdbuf()->is_direct_io() << std::endl;
+            if(f.rdbuf()->is_direct_io())
+            {
+                TEST(f.rdbuf()->buffer_size() == nowide::fd_filebuf::default_buffer_size);
+                f.rdbuf()->buffer_size(5000);
+                TEST(f.rdbuf()->buffer_size() == 2 * alignment);
+            }
+            // Unaligned sizes and flushes in the middle of blocks
+            std::size_t pos = 0;
+            for(std::size_t size = 1; pos < data.size(); size = size * 3 + 1)
+            {
+                const std::size_t count = std::min(size % 100000, data.size() - pos);
+                TEST(f.write(data.data() + pos, static_cast<std::streamsize>(count)));
+                pos += count;
+                if(size % 2)
+                    TEST(f.flush());
+            }
+        }
+        TEST(read_file(filepath) == data);
+        {
+            nowide::fd_ofstream f(filepath, std::ios_base::app, nowide::file_options::direct_io);
+            TEST(f << "tail");
+        }
+        TEST(read_file(filepath) == data + "tail");
+        {
+            nowide::fd_ifstream f(filepath, std::ios_base::in, nowide::file_options::direct_io);
+            TEST(f);
+            std::string result(100, '\0');
+            TEST(f.seekg(alignment + 5));
+            TEST(f.read(&result[0], 100));
+            TEST(result == data.substr(alignment + 5, 100));
+            TEST(f.seekg(3, std::ios_base::cur));
+            TEST(f.read(&result[0], 100));
+            TEST(result == data.substr(alignment + 108, 100));
+            TEST(f.seekg(0));
+            result.assign(data.size() + 10, '\0');
+            TEST(!f.read(&result[0], static_cast<std::streamsize>(result.size())));
+            TEST(f.gcount() == static_cast<std::streamsize>(data.size() + 4));
+            result.resize(data.size() + 4);
+            TEST(result == data + "tail");
+        }
+        {
+            // Overwrite in the middle of a block and read back
+            nowide::fd_fstream f(filepath, std::ios_base::in | std::ios_base::out, nowide::file_options::direct_io);
+            TEST(f);
+            TEST(f.seekp(alignment - 2));
+            TEST(f << "XXXX");
+            TEST(f.seekg(alignment - 3));
+            std::string result(6, '\0');
+            TEST(f.read(&result[0], 6));
+            TEST(result == data.substr(alignment - 3, 1) + "XXXX" + data.substr(alignment + 2, 1));
+            TEST(f << "YY");
+        }
+        std::string expected = data + "tail";
+        expected.replace(alignment - 2, 4, "XXXX");
+        expected.replace(alignment + 3, 2, "YY");
+        TEST(read_file(filepath) == expected);
+        {
+            // Suitable buffers given by the user are used
+            nowide::fd_filebuf buf;
+            TEST(buf.open(filepath, std::ios_base::in, nowide::file_options::direct_io) == &buf);
+            std::vector<char> memory(4 * alignment);
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(memory.data());
+            char* const aligned = memory.data() + (alignment - address % alignment);
+            buf.pubsetbuf(aligned + 1, static_cast<std::streamsize>(2 * alignment));
+            TEST(buf.sgetc() == expected[0]);
+            buf.pubsetbuf(aligned, static_cast<std::streamsize>(2 * alignment));
+            TEST(buf.sgetc() == expected[0]);
+            if(buf.is_direct_io())
+            {
+                TEST(buf.buffer_size() == 2 * alignment);
+                TEST(std::string(aligned, 10) == expected.substr(0, 10));
+                buf.pubsetbuf(aligned, 100);
+                TEST(buf.buffer_size() == alignment);
+            }
+            TEST(buf.pubseekpos(static_cast<std::streamoff>(expected.size() - 2)) == std::streampos(
+                   static_cast<std::streamoff>(expected.size() - 2)));
+            TEST(buf.sbumpc() == 'i');
+            TEST(buf.sbumpc() == 'l');
+            TEST(buf.sbumpc() == EOF);
+            TEST(buf.sungetc() == 'l');
+        }
+        nowide::fd_ifstream f;
+        f.open(filename, std::ios_base::in, nowide::file_options::none | nowide::file_options::direct_io);
+        TEST(f);
+    }
+    std::cout << "-- Access hints and dropping pages behind" << std::endl;
+    {
+        const std::string data = make_data(5 << 20);
+        {
+            nowide::fd_ofstream f(filepath, std::ios_base::out, nowide::file_options::drop_behind);
+            TEST(f);
+            for(std::size_t pos = 0; pos < data.size(); pos += 1000)
+            {
+                const std::size_t count = std::min<std::size_t>(1000, data.size() - pos);
+                TEST(f.write(data.data() + pos, static_cast<std::streamsize>(count)));
+            }
+        }
+        TEST(read_file(filepath) == data);
+        nowide::fd_ifstream f(filepath, std::ios_base::in, nowide::file_options::drop_behind);
+        TEST(f);
+#ifdef __linux__
+        TEST(f.rdbuf()->advise(nowide::file_advice::sequential));
+        TEST(f.rdbuf()->advise(nowide::file_advice::will_need, 0, 1 << 20));
+        TEST(f.rdbuf()->advise(nowide::file_advice::random, 1 << 20));
+        TEST(f.rdbuf()->advise(nowide::file_advice::dont_need, 1 << 20, 1 << 20));
+        TEST(f.rdbuf()->advise(nowide::file_advice::normal));
+#endif
+        std::string result(data.size(), '\0');
+        // Small reads through the buffer, large ones directly, and going back
+        TEST(f.read(&result[0], 3 << 20));
+        TEST(f.seekg(1 << 20));
+        TEST(f.read(&result[1 << 20], 5));
+        for(std::size_t pos = (1 << 20) + 5; pos < data.size(); pos += 1000)
+        {
+            const std::size_t count = std::min<std::size_t>(1000, data.size() - pos);
+            TEST(f.read(&result[pos], static_cast<std::streamsize>(count)));
+        }
+        TEST(result == data);
+        TEST(f.get() == EOF);
+        f.close();
+        TEST(!f.rdbuf()->advise(nowide::file_advice::normal));
+
+        // The file position is tracked, so dropping pages costs no seeks
+        nowide::fd_filebuf buf;
+        TEST(buf.open(filepath, std::ios_base::out, nowide::file_options::drop_behind) == &buf);
+        for(std::size_t pos = 0; pos < data.size(); pos += 1000)
+        {
+            const std::streamsize count = static_cast<std::streamsize>(std::min<std::size_t>(1000, data.size() - pos));
+            TEST(buf.sputn(data.data() + pos, count) == count);
+        }
+        TEST(buf.close() == &buf);
+        TEST(buf.open(filepath, std::ios_base::in, nowide::file_options::drop_behind) == &buf);
+        for(std::size_t pos = 0; pos < data.size(); pos += 1000)
+        {
+            const std::streamsize count = static_cast<std::streamsize>(std::min<std::size_t>(1000, data.size() - pos));
+            TEST(buf.sgetn(&result[pos], count) == count);
+        }
+        TEST(result == data);
+        TEST(buf.statistics().seek_calls == 0u);
+    }
+    std::cout << "-- Preallocation and sparse files" << std::endl;
+    {
+        const std::size_t block = nowide::fd_filebuf::sparse_block_size;
+        const std::string zeros(5 * block, '\0');
+        const std::string data = make_data(3 * block);
+        {
+            nowide::fd_filebuf buf;
+            TEST(!buf.preallocate(100));
+            TEST(buf.open(filepath, std::ios_base::out) == &buf);
+            std::cout << "Preallocation supported: " << buf.preallocate(4 << 20) << std::endl;
+            TEST(buf.pubseekoff(0, std::ios_base::end) == std::streampos(0));
+            TEST(buf.sputn(data.data(), 10) == 10);
+        }
+        TEST(read_file(filepath) == data.substr(0, 10));
+        for(nowide::file_options options : {nowide::file_options::sparse,
+                                            nowide::file_options::sparse | nowide::file_options::direct_io})
+        {
+            std::string expected;
+            {
+                nowide::fd_ofstream f(filepath, std::ios_base::out, options);
+                TEST(f);
+                // Holes in the buffer and in data bypassing it, and at the end of the file
+                TEST(f.write(data.data(), 100));
+                TEST(f.write(zeros.data(), 2 * block));
+                TEST(f.write(data.data(), 100));
+                TEST(f.write(zeros.data(), static_cast<std::streamsize>(zeros.size())));
+                TEST(f.write(data.data(), static_cast<std::streamsize>(data.size())));
+                TEST(f.write(zeros.data(), static_cast<std::streamsize>(zeros.size())));
+                expected = data.substr(0, 100) + zeros.substr(0, 2 * block) + data.substr(0, 100);
+                expected += zeros + data + zeros;
+            }
+            TEST(read_file(filepath) == expected);
+            {
+                // Zeros replace existing data
+                nowide::fd_fstream f(filepath, std::ios_base::in | std::ios_base::out, options);
+                TEST(f);
+                f.rdbuf()->pubsetbuf(nullptr, static_cast<std::streamsize>(block));
+                TEST(f.seekp(static_cast<std::streamoff>(expected.size() - 2 * block)));
+                TEST(f.write(zeros.data(), static_cast<std::streamsize>(2 * block)));
+                expected.replace(expected.size() - 2 * block, 2 * block, zeros.substr(0, 2 * block));
+                TEST(f.seekg(0));
+                std::string result(expected.size(), '\0');
+                TEST(f.read(&result[0], static_cast<std::streamsize>(result.size())));
+                TEST(result == expected);
+            }
+            TEST(read_file(filepath) == expected);
+        }
+        {
+            nowide::fd_filebuf buf;
+            TEST(!buf.punch_hole(0, 1));
+            TEST(buf.open(filepath, std::ios_base::in) == &buf);
+            TEST(!buf.punch_hole(0, 1));
+            TEST(buf.close() == &buf);
+            TEST(buf.open(filepath, std::ios_base::out) == &buf);
+            TEST(buf.sputn(data.data(), static_cast<std::streamsize>(data.size())) == std::streamsize(data.size()));
+            TEST(buf.punch_hole(0, 0));
+            if(buf.punch_hole(block, block))
+            {
+                TEST(buf.close() == &buf);
+                TEST(read_file(filepath) == data.substr(0, block) + zeros.substr(0, block) + data.substr(2 * block));
+            }
+        }
+    }
+    std::cout << "-- Seeking and putting back" << std::endl;
+    {
+        nowide::fd_filebuf buf;
+        buf.buffer_size(4);
+        TEST(buf.open(filepath, std::ios_base::out | std::ios_base::trunc) == &buf);
+        TEST(buf.sputn("abcdefghij", 10) == 10);
+        TEST(buf.close() == &buf);
+        TEST(buf.open(filepath, std::ios_base::in) == &buf);
+        TEST(buf.sbumpc() == 'a');
+        // Within the get area
+        TEST(buf.pubseekoff(2, std::ios_base::cur) == std::streampos(3));
+        TEST(buf.sgetc() == 'd');
+        TEST(buf.pubseekpos(0) == std::streampos(0));
+        TEST(buf.sgetc() == 'a');
+        // Beyond the get area
+        TEST(buf.pubseekoff(5, std::ios_base::cur) == std::streampos(5));
+        TEST(buf.sbumpc() == 'f');
+        TEST(buf.pubseekoff(-2, std::ios_base::end) == std::streampos(8));
+        TEST(buf.sbumpc() == 'i');
+        // Put back across the start of the get area
+        TEST(buf.pubseekpos(4) == std::streampos(4));
+        TEST(buf.sbumpc() == 'e');
+        TEST(buf.sungetc() == 'e');
+        TEST(buf.sungetc() == 'd');
+        TEST(buf.sungetc() == 'c');
+        TEST(buf.pubseekoff(0, std::ios_base::cur) == std::streampos(2));
+        TEST(buf.sbumpc() == 'c');
+        // A different character replaces the buffered one only
+        TEST(buf.sputbackc('C') == 'C');
+        TEST(buf.sbumpc() == 'C');
+        TEST(buf.close() == &buf);
+        TEST(read_file(filepath) == "abcdefghij");
+    }
+    std::cout << "-- Streams" << std::endl;
+    {
+        {
+            nowide::fd_ofstream f(filepath);
+            TEST(f);
+            TEST(f.is_open());
+            f.rdbuf()->buffer_size(1 << 20);
+            f << "Hello " << 42 << '\n';
+        }
+        {
+            nowide::fd_ifstream f(filename);
+            std::string word;
+            int value;
+            TEST(f >> word >> value);
+            TEST(word == "Hello" && value == 42);
+            TEST(!(f >> word));
+        }
+        {
+            nowide::fd_fstream f(filepath);
+            TEST(f);
+            f.seekp(0, std::ios_base::end);
+            TEST(f << "bye");
+            TEST(f.seekg(6));
+            std::string rest;
+            TEST(std::getline(f, rest, '\0') || f.eof());
+            TEST(rest == "42\nbye");
+            f.close();
+            TEST(f);
+            f.close();
+            TEST(!f);
+        }
+        nowide::fd_fstream f(filepath, std::ios_base::in | std::ios_base::app | std::ios_base::trunc);
+        TEST(!f);
+        TEST(!f.is_open());
+    }
+    TEST(nowide::remove(filepath) == 0);
+}
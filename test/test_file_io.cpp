@@ -0,0 +1,162 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/file_io.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <nowide/cstdio.hpp>
+#include <string>
+
+#include "test.hpp"
+
+// Encode UTF-16 code units as bytes in the given byte order
+std::string to_bytes(const std::u16string& str, bool big_endian)
+{
+    std::string result;
+    for(const char16_t c : str)
+    {
+        const char low = static_cast<char>(c & 0xFF);
+        const char high = static_cast<char>(c >> 8);
+        result += big_endian ? high : low;
+        result += big_endian ? low : high;
+    }
+    return result;
+}
+
+void test_main(int, char** argv, char**)
+{
+    const std::string filename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+    const char* const filepath = filename.c_str();
+    nowide::remove(filepath);
+
+    std::cout << "-- Reading and writing whole files" << std::endl;
+    {
+        std::string content = "previous";
+        TEST(!nowide::read_file(filepath, content));
+        TEST(content.empty());
+
+        std::string data;
+        for(int i = 0; i < 100000; i++)
+            data += "line " + std::to_string(i) + '\0' + "\r\n";
+        TEST(nowide::write_file(filepath, data));
+        TEST(nowide::read_file(filepath, content));
+        TEST(content == data);
+        TEST(nowide::read_file(filename, content));
+        TEST(content == data);
+        TEST(nowide::read_file(nowide::filesystem::path(filename), content));
+        TEST(content == data);
+
+        // Truncates the previous content
+        TEST(nowide::write_file(filename, "short"));
+        TEST(nowide::read_file(filepath, content));
+        TEST(content == "short");
+        TEST(nowide::write_file(nowide::filesystem::path(filename), ""));
+        TEST(nowide::read_file(filepath, content));
+        TEST(content.empty());
+        TEST(nowide::remove(filepath) == 0);
+    }
+    std::cout << "-- Reads returning less than asked for" << std::endl;
+    {
+        // Like reading more than 2 GiB from a regular file on Linux
+        std::string data;
+        for(int i = 0; i < 10000; i++)
+            data += "line " + std::to_string(i) + "\n";
+        for(const std::size_t size_hint : {data.size(), std::size_t(0), std::size_t(10), data.size() * 2})
+        {
+            std::size_t pos = 0;
+            int calls = 0;
+            std::string content = "previous";
+            TEST(nowide::detail::read_all(content, size_hint, [&](char* buffer, std::size_t size) {
+                calls++;
+                const std::size_t count = std::min({size, data.size() - pos, std::size_t(1000)});
+                std::memcpy(buffer, data.data() + pos, count);
+                pos += count;
+                return static_cast<std::ptrdiff_t>(count);
+            }));
+            TEST(content == data);
+            // Read on until the end without reallocating
+            if(size_hint == data.size())
+                TEST(calls == static_cast<int>((data.size() + 999) / 1000) + 1);
+        }
+        std::string content = "previous";
+        TEST(!nowide::detail::read_all(content, 10, [](char*, std::size_t) { return std::ptrdiff_t(-1); }));
+        TEST(content.empty());
+    }
+#ifndef NOWIDE_WINDOWS
+    std::cout << "-- Files with unknown sizes" << std::endl;
+    {
+        std::string content = "previous";
+        TEST(nowide::read_file("/dev/null", content));
+        TEST(content.empty());
+        // Claims to be an empty regular file but isn't
+        if(nowide::read_file("/proc/self/maps", content))
+            TEST(!content.empty());
+    }
+#endif
+    std::cout << "-- Reading UTF-16" << std::endl;
+    {
+        // A surrogate pair is split by the end of the first block the file is converted in
+        std::u16string text = u"a\u00e4\u20ac";
+        while(text.size() < 3 * nowide::detail::read_block_size / 2)
+            text += u"x\U0001F600";
+        TEST(text[nowide::detail::read_block_size / 2 - 1] == 0xD83D);
+        const std::string expected = nowide::utf::convert_string<char>(text.data(), text.data() + text.size());
+        std::string content;
+        for(const bool big_endian : {false, true})
+        {
+            const std::string bom = to_bytes(u"\uFEFF", big_endian);
+            const std::string data = to_bytes(text, big_endian);
+            const nowide::file_encoding encoding =
+              big_endian ? nowide::file_encoding::utf16be : nowide::file_encoding::utf16le;
+
+            TEST(nowide::write_file(filepath, data));
+            TEST(nowide::read_file(filepath, content, encoding));
+            TEST(content == expected);
+
+            // Byte order mark
+            TEST(nowide::write_file(filepath, bom + data));
+            TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16));
+            TEST(content == expected);
+            TEST(nowide::read_file(filepath, content, encoding));
+            TEST(content == "\xef\xbb\xbf" + expected);
+            TEST(nowide::write_file(filepath, bom));
+            TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16));
+            TEST(content.empty());
+        }
+        // Little endian without a byte order mark
+        TEST(nowide::write_file(filepath, to_bytes(text, false)));
+        TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16));
+        TEST(content == expected);
+
+        // Invalid sequences
+        const std::string replacement = "\xef\xbf\xbd";
+        TEST(nowide::write_file(filepath, to_bytes(u"a", false) + "b"));
+        TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16));
+        TEST(content == "a" + replacement);
+        TEST(nowide::write_file(filepath, "b"));
+        TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16le));
+        TEST(content == replacement);
+        const std::u16string unpaired = {u'a', 0xD83D, u'b', 0xDE00};
+        TEST(nowide::write_file(filepath, to_bytes(unpaired, true)));
+        TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16be));
+        // Same as the conversion of strings
+        TEST(content == nowide::utf::convert_string<char>(unpaired.data(), unpaired.data() + unpaired.size()));
+        TEST(nowide::write_file(filepath, to_bytes(unpaired, true).substr(0, 4)));
+        TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16be));
+        TEST(content == "a" + replacement);
+
+        TEST(nowide::write_file(filepath, ""));
+        TEST(nowide::read_file(filepath, content, nowide::file_encoding::utf16));
+        TEST(content.empty());
+        TEST(nowide::remove(filepath) == 0);
+        TEST(!nowide::read_file(filepath, content, nowide::file_encoding::utf16));
+        TEST(content.empty());
+    }
+}
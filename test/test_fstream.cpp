@@ -14,6 +14,7 @@
 #include <nowide/convert.hpp>
 #include <nowide/cstdio.hpp>
 #include <string>
+#include <utility>
 
 #include "test.hpp"
 
@@ -473,6 +474,47 @@ void test_is_open(const char* filename)
     TEST(nw::remove(filename) == 0);
 }
 
+void test_move_and_swap(const char* filename)
+{
+    {
+        nw::ofstream f_old(filename);
+        TEST(f_old << "Hello ");
+        nw::ofstream f(std::move(f_old));
+        TEST(f << "World");
+        nw::ofstream f2;
+        f2 = std::move(f);
+        TEST(is_open(f2));
+        TEST(f2 << "!");
+    }
+    TEST(read_file(filename) == "Hello World!");
+    {
+        nw::ifstream f1(filename), f2;
+        f2.swap(f1);
+        TEST(!is_open(f1));
+        TEST(is_open(f2));
+        std::string s;
+        TEST(f2 >> s);
+        TEST(s == "Hello");
+        nw::ifstream f3(std::move(f2));
+        TEST(f3 >> s);
+        TEST(s == "World!");
+        TEST(!(f3 >> s));
+        f1 = std::move(f3);
+        TEST(f1.eof());
+    }
+    {
+        nw::fstream f1(filename, std::ios_base::in | std::ios_base::out);
+        TEST(f1 << "Bye");
+        nw::fstream f2(std::move(f1));
+        TEST(f2.seekg(0));
+        std::string s;
+        TEST(f2 >> s);
+        TEST(s == "Byelo");
+    }
+    TEST(read_file(filename) == "Byelo World!");
+    TEST(nw::remove(filename) == 0);
+}
+
 void test_main(int, char** argv, char**)
 {
     const std::string exampleFilename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
@@ -482,6 +524,7 @@ void test_main(int, char** argv, char**)
     test_ifstream_open_read(exampleFilename.c_str());
     test_fstream(exampleFilename.c_str());
     test_is_open(exampleFilename.c_str());
+    test_move_and_swap(exampleFilename.c_str());
 
     std::cout << "Complex IO" << std::endl;
     test_with_different_buffer_sizes(exampleFilename.c_str());
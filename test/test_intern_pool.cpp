@@ -0,0 +1,111 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/intern_pool.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+#include "test_sets.hpp"
+
+nowide::intern_pool pool(64);
+
+std::wstring pool_to_wide(const std::string& s)
+{
+    const nowide::intern_pool::handle h = pool.intern(s);
+    TEST(pool.narrow(h) == s);
+    TEST(pool.wc_str(h)[pool.wide(h).size()] == 0);
+    return std::wstring(pool.wide(h));
+}
+
+std::string pool_to_narrow(const std::wstring& s)
+{
+    const nowide::intern_pool::handle h = pool.intern(std::wstring_view(s));
+    TEST(pool.c_str(h)[pool.narrow(h).size()] == 0);
+    return std::string(pool.narrow(h));
+}
+
+void test_main(int, char**, char**)
+{
+    const std::string hello = "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d";
+    const std::wstring whello = nowide::widen(hello);
+
+    {
+        std::cout << "-- Equal strings get equal handles" << std::endl;
+        nowide::intern_pool p;
+        const auto h1 = p.intern(hello);
+        const auto h2 = p.intern("foo");
+        TEST(h1 != h2);
+        TEST(p.intern(std::string_view(hello)) == h1);
+        TEST(p.intern(std::wstring_view(whello)) == h1);
+        TEST(p.size() == 2u);
+        TEST(p.wide(h1) == whello);
+        TEST(p.c_str(h2) == std::string_view("foo"));
+        TEST(p.wc_str(h2) == std::wstring_view(L"foo"));
+        nowide::intern_pool::handle found = 42;
+        TEST(p.find("foo", found));
+        TEST(found == h2);
+        TEST(!p.find("bar", found));
+        TEST(found == h2);
+        const auto empty = p.intern("");
+        TEST(p.narrow(empty).empty());
+        TEST(p.wide(empty).empty());
+        TEST(p.c_str(empty)[0] == 0);
+    }
+    {
+        std::cout << "-- Pointers are stable and memory is reported" << std::endl;
+        nowide::intern_pool p(128);
+        TEST(p.arena_bytes() == 0u);
+        const auto first = p.intern(hello);
+        const char* narrow = p.c_str(first);
+        const wchar_t* wide = p.wc_str(first);
+        std::vector<std::string> paths;
+        for(int i = 0; i < 200; i++)
+            paths.push_back("dir/" + hello + "/file" + std::to_string(i));
+        for(const std::string& path : paths)
+            p.intern(path);
+        TEST(p.size() == paths.size() + 1);
+        TEST(p.c_str(first) == narrow);
+        TEST(p.wc_str(first) == wide);
+        TEST(narrow == hello);
+        TEST(wide == whello);
+        for(const std::string& path : paths)
+        {
+            nowide::intern_pool::handle h;
+            TEST(p.find(path, h));
+            TEST(p.narrow(h) == path);
+            TEST(p.wide(h) == nowide::widen(path));
+        }
+        TEST(p.arena_bytes() > 128u);
+        TEST(p.memory_usage() > p.arena_bytes());
+        // Interning known wide strings again reuses the room converted into
+        const std::size_t arena_bytes = p.arena_bytes();
+        for(int i = 0; i < 10; i++)
+        {
+            for(const std::string& path : paths)
+                TEST(p.narrow(p.intern(std::wstring_view(nowide::widen(path)))) == path);
+        }
+        TEST(p.size() == paths.size() + 1);
+        TEST(p.arena_bytes() <= arena_bytes + 128u);
+        p.clear();
+        TEST(p.size() == 0u);
+        TEST(p.arena_bytes() == 0u);
+    }
+    {
+        std::cout << "-- Strings larger than a block" << std::endl;
+        nowide::intern_pool p(16);
+        const std::string large(100, 'x');
+        const auto h = p.intern(large);
+        TEST(p.narrow(h) == large);
+        TEST(p.wide(h) == std::wstring(100, L'x'));
+    }
+    std::cout << "- Intern pool" << std::endl;
+    run_all(pool_to_wide, pool_to_narrow);
+}
@@ -0,0 +1,124 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/mapped_file.hpp>
+
+#include <iostream>
+#include <iterator>
+#include <nowide/cstdio.hpp>
+#include <nowide/fstream.hpp>
+#include <string>
+#include <utility>
+
+#include "test.hpp"
+
+void write_file(const char* filepath, const std::string& content, std::ios_base::openmode mode = std::ios_base::out)
+{
+    nowide::ofstream f(filepath, mode | std::ios_base::binary);
+    TEST(f.write(content.data(), static_cast<std::streamsize>(content.size())));
+}
+
+std::string read_file(const char* filepath)
+{
+    nowide::ifstream f(filepath, std::ios_base::binary);
+    TEST(f);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void test_main(int, char** argv, char**)
+{
+    const std::string filename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+    const char* const filepath = filename.c_str();
+
+    std::cout << "-- Read-only" << std::endl;
+    {
+        const std::string content(100000, 'x');
+        write_file(filepath, content);
+        nowide::mapped_file f(filepath, nowide::map_access::read_only, nowide::map_options::populate);
+        TEST(f.is_open());
+        TEST(f.access() == nowide::map_access::read_only);
+        TEST(f.size() == content.size());
+        TEST(f.view() == content);
+        TEST(f.advise(nowide::map_advice::sequential));
+        TEST(f.flush());
+#ifdef __cpp_lib_span
+        TEST(f.bytes().size() == content.size());
+        TEST(f.bytes()[0] == std::byte('x'));
+#endif
+        TEST(!f.open(filepath));
+        TEST(!f.resize(10));
+        // Moving
+        nowide::mapped_file g(std::move(f));
+        TEST(!f.is_open());
+        TEST(f.view().empty());
+        TEST(g.view() == content);
+        f = std::move(g);
+        TEST(!g.is_open());
+        TEST(f.view() == content);
+        TEST(f.close());
+        TEST(!f.close());
+        TEST(!f.is_open());
+        TEST(f.data() == nullptr);
+    }
+    std::cout << "-- Growing files" << std::endl;
+    {
+        write_file(filepath, "");
+        nowide::mapped_file f(nowide::filesystem::path(filename), nowide::map_access::read_only,
+                              nowide::map_options::populate | nowide::map_options::huge_pages);
+        TEST(f.is_open());
+        TEST(f.empty());
+        TEST(f.data() == nullptr);
+        TEST(f.view().empty());
+        TEST(f.advise(nowide::map_advice::will_need));
+        TEST(f.remap());
+        TEST(f.empty());
+        write_file(filepath, "Hello", std::ios_base::app);
+        TEST(f.empty());
+        TEST(f.remap());
+        TEST(f.view() == "Hello");
+        write_file(filepath, " World", std::ios_base::app);
+        TEST(f.remap());
+        TEST(f.view() == "Hello World");
+        TEST(f.remap());
+        TEST(f.view() == "Hello World");
+    }
+    std::cout << "-- Read-write" << std::endl;
+    {
+        write_file(filepath, "abc");
+        nowide::mapped_file f(filename, nowide::map_access::read_write);
+        TEST(f.is_open());
+        f.data()[1] = 'B';
+        TEST(f.flush());
+        TEST(read_file(filepath) == "aBc");
+        TEST(f.resize(6));
+        TEST(f.view() == std::string("aBc\0\0\0", 6));
+        f.data()[5] = 'f';
+        TEST(f.resize(0));
+        TEST(f.empty());
+        TEST(f.flush());
+        TEST(f.resize(2));
+        f.data()[0] = 'x';
+        TEST(f.close());
+        TEST(read_file(filepath) == std::string("x\0", 2));
+    }
+    std::cout << "-- Failures" << std::endl;
+    {
+        TEST(nowide::remove(filepath) == 0);
+        nowide::mapped_file f(filepath);
+        TEST(!f.is_open());
+        TEST(!f.remap());
+        TEST(!f.flush());
+        TEST(!f.advise(nowide::map_advice::normal));
+        TEST(!f.open(filepath, nowide::map_access::read_write));
+#ifndef NOWIDE_WINDOWS
+        // Not a regular file
+        TEST(!f.open("/dev/zero"));
+        TEST(!f.is_open());
+#endif
+    }
+}
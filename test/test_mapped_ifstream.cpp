@@ -0,0 +1,138 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/mapped_ifstream.hpp>
+
+#include <iostream>
+#include <iterator>
+#include <nowide/cstdio.hpp>
+#include <nowide/fstream.hpp>
+#include <string>
+
+#include "test.hpp"
+
+void write_file(const char* filepath, const std::string& content)
+{
+    nowide::ofstream f(filepath, std::ios_base::out | std::ios_base::binary);
+    TEST(f.write(content.data(), static_cast<std::streamsize>(content.size())));
+}
+
+void test_main(int, char** argv, char**)
+{
+    const std::string filename = std::string(argv[0]) + "-\xd7\xa9-\xd0\xbc-\xce\xbd.txt";
+    const char* const filepath = filename.c_str();
+
+    std::cout << "-- Reading and seeking" << std::endl;
+    {
+        std::string content;
+        for(int i = 0; i < 10000; i++)
+            content += "line " + std::to_string(i) + "\r\n";
+        write_file(filepath, content);
+
+        nowide::mapped_ifstream f(filepath);
+        TEST(f);
+        TEST(f.is_open());
+        TEST(f.is_mapped());
+        std::string line;
+        TEST(std::getline(f, line));
+        TEST(line == "line 0\r");
+        TEST(f.tellg() == std::streampos(8));
+        TEST(f.seekg(-11, std::ios_base::end));
+        TEST(std::getline(f, line));
+        TEST(line == "line 9999\r");
+        TEST(!std::getline(f, line));
+        f.clear();
+        TEST(f.seekg(static_cast<std::streamoff>(content.find("line 5000"))));
+        std::string word;
+        int value;
+        TEST(f >> word >> value);
+        TEST(value == 5000);
+        TEST(f.seekg(-4, std::ios_base::cur));
+        TEST(f >> value);
+        TEST(value == 5000);
+        // Out of range
+        TEST(!f.seekg(1, std::ios_base::end));
+        f.clear();
+        TEST(!f.seekg(-1));
+        f.clear();
+        // Read everything at once
+        TEST(f.seekg(0));
+        std::string all(content.size() + 1, '\0');
+        TEST(!f.read(&all[0], static_cast<std::streamsize>(all.size())));
+        TEST(f.gcount() == static_cast<std::streamsize>(content.size()));
+        all.resize(content.size());
+        TEST(all == content);
+        f.clear();
+        f.close();
+        TEST(f);
+        TEST(!f.is_open());
+        f.close();
+        TEST(!f);
+    }
+    std::cout << "-- Open modes and file name types" << std::endl;
+    {
+        write_file(filepath, "abc");
+        nowide::mapped_ifstream f(filename, std::ios_base::ate | std::ios_base::binary);
+        TEST(f);
+        TEST(f.tellg() == std::streampos(3));
+        f.open(filepath);
+        TEST(!f);
+        f.close();
+        f.clear();
+        f.open(nowide::filesystem::path(filename));
+        TEST(f);
+        TEST(f.get() == 'a');
+        TEST(f.unget());
+        TEST(f.get() == 'a');
+        TEST(!f.putback('x'));
+        f.close();
+        nowide::mapped_filebuf buf;
+        TEST(!buf.open(filepath, std::ios_base::in | std::ios_base::out));
+        TEST(!buf.open(filepath, std::ios_base::app));
+        TEST(buf.open(filepath) == &buf);
+        TEST(buf.in_avail() == 3);
+        TEST(buf.close() == &buf);
+        TEST(nowide::remove(filepath) == 0);
+        TEST(!buf.open(filepath));
+        f.open(filepath);
+        TEST(!f);
+    }
+    std::cout << "-- Empty file" << std::endl;
+    {
+        write_file(filepath, "");
+        nowide::mapped_ifstream f(filepath);
+        TEST(f);
+        TEST(!f.is_mapped());
+        TEST(f.get() == EOF);
+        f.clear();
+        TEST(f.seekg(0, std::ios_base::end));
+        TEST(f.tellg() == std::streampos(0));
+    }
+#ifndef NOWIDE_WINDOWS
+    std::cout << "-- Devices are read through a buffer" << std::endl;
+    {
+        nowide::mapped_ifstream f("/dev/zero");
+        TEST(f);
+        TEST(!f.is_mapped());
+        std::string data(100000, 'x');
+        TEST(f.read(&data[0], static_cast<std::streamsize>(data.size())));
+        TEST(data == std::string(data.size(), '\0'));
+    }
+    {
+        // Claims to be an empty regular file but isn't
+        nowide::mapped_ifstream f("/proc/self/maps");
+        if(f)
+        {
+            TEST(!f.is_mapped());
+            const std::string data{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+            TEST(!data.empty());
+        }
+    }
+#endif
+    TEST(nowide::remove(filepath) == 0);
+}
@@ -0,0 +1,81 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/scratch.hpp>
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "test.hpp"
+#include "test_sets.hpp"
+
+std::wstring scratch_to_wide(const std::string& s)
+{
+    const std::wstring_view result = nowide::scratch::widen(s);
+    TEST(result.data()[result.size()] == 0);
+    return std::wstring(result);
+}
+
+std::string scratch_to_narrow(const std::wstring& s)
+{
+    const std::string_view result = nowide::scratch::narrow(s);
+    TEST(result.data()[result.size()] == 0);
+    return std::string(result);
+}
+
+void test_main(int, char**, char**)
+{
+    const std::string hello = "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d";
+    const std::wstring whello = nowide::widen(hello);
+
+    {
+        std::cout << "-- Buffers are reused" << std::endl;
+        const std::wstring_view first = nowide::scratch::widen(hello);
+        TEST(first == whello);
+        const std::size_t capacity = nowide::scratch::capacity<wchar_t>();
+        TEST(capacity >= whello.size() + 1);
+        const std::wstring_view second = nowide::scratch::widen("abc");
+        TEST(second == std::wstring_view(L"abc"));
+        TEST(second.data() == first.data());
+        TEST(nowide::scratch::capacity<wchar_t>() == capacity);
+        // Narrow conversions use their own buffer
+        const std::string_view narrowed = nowide::scratch::narrow(whello.c_str(), whello.c_str() + whello.size());
+        TEST(narrowed == hello);
+        TEST(nowide::scratch::widen(hello.c_str(), hello.c_str() + 2) == whello.substr(0, 1));
+        TEST(narrowed == hello);
+    }
+    {
+        std::cout << "-- Buffers grow" << std::endl;
+        const std::string large(10000, 'x');
+        const std::wstring_view result = nowide::scratch::widen(large);
+        TEST(result == std::wstring(large.size(), L'x'));
+        TEST(nowide::scratch::capacity<wchar_t>() > large.size());
+        TEST(nowide::scratch::widen("").empty());
+    }
+    {
+        std::cout << "-- Buffers are thread local" << std::endl;
+        const std::wstring_view main_view = nowide::scratch::widen(hello);
+        std::wstring_view thread_view;
+        std::thread t([&]() {
+            thread_view = nowide::scratch::widen("other");
+            TEST(thread_view == std::wstring_view(L"other"));
+        });
+        t.join();
+        TEST(thread_view.data() != main_view.data());
+        TEST(main_view == whello);
+    }
+    {
+        std::cout << "-- Buffers can be released" << std::endl;
+        nowide::scratch::release<wchar_t>();
+        TEST(nowide::scratch::capacity<wchar_t>() == 0u);
+        TEST(nowide::scratch::widen(hello) == whello);
+    }
+    std::cout << "- Scratch conversions" << std::endl;
+    run_all(scratch_to_wide, scratch_to_narrow);
+}
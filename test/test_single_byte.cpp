@@ -0,0 +1,185 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/utf/single_byte.hpp>
+
+#include <iostream>
+#include <iterator>
+#include <nowide/transcoding_streambuf.hpp>
+#include <nowide/utf/convert.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+
+using nowide::utf::latin1_char;
+using nowide::utf::windows1252_char;
+
+template<typename CharType>
+std::vector<CharType> to_chars(const std::string& bytes)
+{
+    return std::vector<CharType>(bytes.begin(), bytes.end());
+}
+
+template<typename CharType>
+std::string to_bytes(const CharType* begin, const CharType* end)
+{
+    std::string result;
+    for(; begin != end; ++begin)
+        result += static_cast<char>(static_cast<unsigned char>(*begin));
+    return result;
+}
+
+/// Convert code point by code point
+template<typename CharOut, typename CharIn>
+std::vector<CharOut> convert_slow(const CharIn* begin, const CharIn* end)
+{
+    std::vector<CharOut> result;
+    while(begin != end)
+    {
+        nowide::utf::code_point c = nowide::utf::utf_traits<CharIn>::decode(begin, end);
+        if(c == nowide::utf::illegal || c == nowide::utf::incomplete)
+            c = NOWIDE_REPLACEMENT_CHARACTER;
+        nowide::utf::utf_traits<CharOut>::encode(c, std::back_inserter(result));
+    }
+    return result;
+}
+
+/// Convert with convert_prefix to an output of \a out_size units and check the result against convert_slow
+template<typename CharOut, typename CharIn>
+void test_prefix(const std::vector<CharIn>& input, std::size_t out_size)
+{
+    const std::vector<CharOut> expected = convert_slow<CharOut>(input.data(), input.data() + input.size());
+    std::vector<CharOut> buffer(out_size);
+    std::vector<CharOut> result;
+    const CharIn* from = input.data();
+    bool done = false;
+    while(!done)
+    {
+        CharOut* to = buffer.data();
+        done = nowide::utf::convert_prefix(to, to + buffer.size(), from, input.data() + input.size());
+        TEST(done || to != buffer.data());
+        result.insert(result.end(), buffer.data(), to);
+    }
+    TEST(result == expected);
+}
+
+template<typename CharType>
+void test_kernels(const std::string& bytes)
+{
+    const std::vector<CharType> input = to_chars<CharType>(bytes);
+    for(std::size_t out_size : {4, 17, 1000})
+    {
+        test_prefix<char>(input, out_size);
+        test_prefix<char16_t>(input, out_size);
+        test_prefix<char32_t>(input, out_size);
+        test_prefix<nowide::utf::be16>(input, out_size);
+    }
+    const std::u16string utf16 = nowide::utf::convert_string<char16_t>(input.data(), input.data() + input.size());
+    const std::u32string utf32 = nowide::utf::convert_string<char32_t>(input.data(), input.data() + input.size());
+    const std::string utf8 = nowide::utf::convert_string<char>(input.data(), input.data() + input.size());
+    for(std::size_t out_size : {4, 17, 1000})
+    {
+        test_prefix<CharType>(std::vector<char16_t>(utf16.begin(), utf16.end()), out_size);
+        test_prefix<CharType>(std::vector<char32_t>(utf32.begin(), utf32.end()), out_size);
+        test_prefix<CharType>(std::vector<char>(utf8.begin(), utf8.end()), out_size);
+    }
+}
+
+void test_main(int, char**, char**)
+{
+    std::string all_bytes;
+    for(int i = 0; i < 256; i++)
+        all_bytes += static_cast<char>(i);
+
+    std::cout << "-- Latin-1" << std::endl;
+    {
+        const std::vector<latin1_char> input = to_chars<latin1_char>(all_bytes);
+        const std::u32string utf32 = nowide::utf::convert_string<char32_t>(input.data(), input.data() + 256);
+        TEST(utf32.size() == 256u);
+        for(std::size_t i = 0; i < utf32.size(); i++)
+            TEST(utf32[i] == i);
+        const std::string utf8 = nowide::utf::convert_string<char>(input.data(), input.data() + 256);
+        TEST(utf8.size() == 128u + 2 * 128u);
+        TEST(utf8.substr(0xE9 + 0x69, 2) == "\xc3\xa9");
+        // Back to Latin-1, code points above 0xFF are replaced
+        std::u16string utf16 = nowide::utf::convert_string<char16_t>(input.data(), input.data() + 256);
+        utf16 += u"\u0100\u20ac";
+        std::vector<latin1_char> back(utf16.size());
+        latin1_char* to = back.data();
+        const char16_t* from = utf16.data();
+        TEST(nowide::utf::convert_prefix(to, to + back.size(), from, from + utf16.size()));
+        TEST(to_bytes(back.data(), to) == all_bytes + "??");
+    }
+    std::cout << "-- Windows-1252" << std::endl;
+    {
+        const std::vector<windows1252_char> input = to_chars<windows1252_char>(all_bytes);
+        const std::u16string utf16 = nowide::utf::convert_string<char16_t>(input.data(), input.data() + 256);
+        TEST(utf16.size() == 256u);
+        TEST(utf16[0x41] == u'A');
+        TEST(utf16[0x80] == 0x20AC);
+        TEST(utf16[0x81] == 0x81);
+        TEST(utf16[0x9F] == 0x178);
+        TEST(utf16[0xE9] == 0xE9);
+        // All bytes round trip
+        const std::string utf8 = nowide::utf::convert_string<char>(input.data(), input.data() + 256);
+        const std::vector<windows1252_char> back =
+          convert_slow<windows1252_char>(utf8.data(), utf8.data() + utf8.size());
+        TEST(to_bytes(back.data(), back.data() + back.size()) == all_bytes);
+        // Not in Windows-1252
+        const std::u32string missing = U"\u0080\u0100\U0001F600a";
+        const std::vector<windows1252_char> replaced =
+          convert_slow<windows1252_char>(missing.data(), missing.data() + missing.size());
+        TEST(to_bytes(replaced.data(), replaced.data() + replaced.size()) == "???a");
+    }
+    std::cout << "-- Block kernels" << std::endl;
+    {
+        for(std::size_t pos = 0; pos < 40; pos += 3)
+        {
+            std::string text(100, 'a');
+            text[pos] = '\xE9';
+            text[pos + 20] = '\x80';
+            text.insert(pos + 40, all_bytes);
+            test_kernels<latin1_char>(text);
+            test_kernels<windows1252_char>(text);
+        }
+        // Code units above 0xFF at all positions of the blocks
+        for(std::size_t pos = 0; pos < 40; pos++)
+        {
+            std::u16string text(60, u'\u00e9');
+            text[pos] = u'\u0100';
+            text[pos + 5] = u'\u20ac';
+            std::vector<latin1_char> out(text.size());
+            latin1_char* to = out.data();
+            const char16_t* from = text.data();
+            TEST(nowide::utf::convert_prefix(to, to + out.size(), from, from + text.size()));
+            std::string expected(60, '\xE9');
+            expected[pos] = expected[pos + 5] = '?';
+            TEST(to_bytes(out.data(), to) == expected);
+        }
+    }
+    std::cout << "-- transcoding_streambuf" << std::endl;
+    {
+        const std::string bytes = all_bytes + all_bytes + "\r\nend\r\n";
+        std::stringbuf raw(bytes);
+        nowide::transcoding_streambuf<char16_t, latin1_char> buf(&raw, 17);
+        std::basic_istream<char16_t> is(&buf);
+        const std::u16string text((std::istreambuf_iterator<char16_t>(is)), std::istreambuf_iterator<char16_t>());
+        TEST(text.size() == bytes.size());
+        TEST(text[0xE9] == 0xE9);
+
+        std::stringbuf out;
+        {
+            nowide::transcoding_streambuf<char16_t, latin1_char> obuf(&out, 17);
+            std::basic_ostream<char16_t> os(&obuf);
+            os.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+        TEST(out.str() == bytes);
+    }
+}
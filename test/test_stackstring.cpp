@@ -251,6 +251,63 @@ void test_main(int, char**, char**)
         TEST(strings[1] == std::wstring_view(L"Hello World"));
         TEST(strings[2] == std::wstring_view(L"FooBar"));
     }
+    {
+        std::cout << "-- Append converts only the new suffix" << std::endl;
+        const std::string dir = "dir/" + hello;
+        const std::wstring wdir = nowide::widen(dir);
+        test_basic_stackstring<wchar_t, char, 16> s(dir.c_str());
+        TEST(s.uses_stack_memory());
+        const std::size_t dir_len = s.length();
+        TEST(dir_len == wdir.size());
+        TEST(s.append("/") == wdir + L"/");
+        TEST(s.append(hello) == wdir + L"/" + whello);
+        TEST(s.uses_stack_memory());
+        TEST(s.length() == wdir.size() + 1 + whello.size());
+        s.truncate(dir_len);
+        TEST(s.data() == wdir);
+        TEST(s.append("/file.txt") == wdir + L"/file.txt");
+        TEST(s.uses_heap_memory());
+        TEST(s.length() == wdir.size() + 9);
+        s.truncate(dir_len);
+        TEST(s.uses_heap_memory());
+        TEST(s.data() == wdir);
+        TEST(s.append(std::string_view("/x")) == wdir + L"/x");
+        // Truncating to a larger size does nothing
+        s.truncate(1000);
+        TEST(s.data() == wdir + L"/x");
+    }
+    {
+        std::cout << "-- Append to NULL starts a new string" << std::endl;
+        test_basic_stackstring<char, wchar_t, 5> s;
+        TEST(s.append(static_cast<const wchar_t*>(nullptr)) == nullptr);
+        TEST(s.append(L"ab") == std::string_view("ab"));
+        TEST(s.append(whello.c_str(), whello.c_str() + 1) == "ab" + hello.substr(0, 2));
+        TEST(s.uses_stack_memory());
+        TEST(s.append(whello.c_str() + 1, whello.c_str() + whello.size()) == "ab" + hello);
+        TEST(s.uses_heap_memory());
+        test_basic_stackstring<char, wchar_t, 5> s2(s), s3;
+        TEST(s2.data() == "ab" + hello);
+        s3 = std::move(s2);
+        TEST(s3.append(L"!") == "ab" + hello + "!");
+        TEST(s3.length() == 2 + hello.size() + 1);
+    }
+    {
+        std::cout << "-- Appending many segments grows the buffer geometrically" << std::endl;
+        test_basic_stackstring<wchar_t, char, 16> s("");
+        std::wstring expected;
+        int reallocations = 0;
+        for(int i = 0; i < 1000; i++)
+        {
+            const wchar_t* const previous = s.data();
+            s.append("/seg");
+            expected += L"/seg";
+            if(s.data() != previous)
+                reallocations++;
+        }
+        TEST(s.uses_heap_memory());
+        TEST(s.data() == expected);
+        TEST(reallocations <= 12);
+    }
     std::cout << "- Stackstring" << std::endl;
     run_all(stackstring_to_wide, stackstring_to_narrow);
     std::cout << "- Heap Stackstring" << std::endl;
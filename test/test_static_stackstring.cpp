@@ -0,0 +1,106 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <stdexcept>
+
+#ifndef NOWIDE_NO_HEAP_FALLBACK
+#define NOWIDE_NO_HEAP_FALLBACK
+#endif
+#define NOWIDE_HEAP_FALLBACK_HANDLER() throw std::logic_error("heap fallback")
+
+#include <iostream>
+#include <nowide/stackstring.hpp>
+#include <string_view>
+
+#include "test.hpp"
+#include "test_sets.hpp"
+
+std::wstring static_stackstring_to_wide(const std::string& s)
+{
+    const nowide::static_stackstring<wchar_t, char, 256> ss(s.c_str());
+    TEST(!ss.overflow());
+    return ss.data();
+}
+
+std::string static_stackstring_to_narrow(const std::wstring& s)
+{
+    const nowide::static_stackstring<char, wchar_t, 256> ss(s.c_str());
+    TEST(!ss.overflow());
+    return ss.data();
+}
+
+void test_main(int, char**, char**)
+{
+    // Hebrew "shalom", each code point is 2 bytes in UTF-8
+    const std::string_view hello = "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d";
+    const std::wstring whello_str = nowide::widen(hello);
+    const std::wstring_view whello = whello_str;
+
+    {
+        std::cout << "-- Default constructed and NULL input result in nullptr" << std::endl;
+        const nowide::static_stackstring<> s;
+        TEST(s.data() == nullptr);
+        TEST(!s.overflow());
+        const nowide::static_stackstring<> s2(static_cast<const char*>(nullptr));
+        TEST(s2.data() == nullptr);
+        TEST(s2.empty());
+    }
+    {
+        std::cout << "-- Fitting string is converted" << std::endl;
+        nowide::static_stackstring<wchar_t, char, 5> s(hello);
+        TEST(!s.overflow());
+        TEST(s == whello);
+        TEST(s.length() == whello.length());
+        TEST(s.convert(""));
+        TEST(s.empty());
+        TEST(!s.overflow());
+    }
+    {
+        std::cout << "-- Overflow fails by default" << std::endl;
+        nowide::static_stackstring<wchar_t, char, 4> s(hello);
+        TEST(s.overflow());
+        TEST(s.data() == nullptr);
+        TEST(s.empty());
+        TEST(s.convert(hello.substr(0, 4)) == whello.substr(0, 2));
+        TEST(!s.overflow());
+    }
+    {
+        std::cout << "-- Overflow truncates at code point boundary" << std::endl;
+        nowide::static_stackstring<char, wchar_t, 6> s(whello, nowide::overflow_policy::truncate);
+        TEST(s.overflow());
+        // 5 chars available, but only 2 complete code points fit
+        TEST(s == hello.substr(0, 4));
+        TEST(s.length() == 4u);
+        TEST(s.convert(whello.data(), whello.data() + 1, nowide::overflow_policy::truncate) == hello.substr(0, 2));
+        TEST(!s.overflow());
+    }
+    {
+        std::cout << "-- Copies are independent" << std::endl;
+        nowide::static_stackstring<wchar_t, char, 16> s(hello), s2;
+        s2 = s;
+        s.convert("foo");
+        TEST(s2 == whello);
+        TEST(s == std::wstring_view(L"foo"));
+    }
+    {
+        std::cout << "-- Heap fallback of basic_stackstring is an error" << std::endl;
+        const nowide::basic_stackstring<wchar_t, char, 9> fits(hello);
+        TEST(fits == whello);
+        bool caught = false;
+        try
+        {
+            const nowide::basic_stackstring<wchar_t, char, 4> s(hello);
+        } catch(const std::logic_error&)
+        {
+            caught = true;
+        }
+        TEST(caught);
+    }
+    std::cout << "- Static stackstring" << std::endl;
+    run_all(static_stackstring_to_wide, static_stackstring_to_narrow);
+}
@@ -0,0 +1,183 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/transcoding_streambuf.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "test.hpp"
+
+/// Stream buffer returning at most \a chunk bytes per read like a pipe
+class chunked_stringbuf : public std::stringbuf
+{
+public:
+    chunked_stringbuf(const std::string& s, std::streamsize chunk) : std::stringbuf(s), chunk_(chunk)
+    {}
+
+protected:
+    std::streamsize xsgetn(char* s, std::streamsize n) override
+    {
+        return std::stringbuf::xsgetn(s, std::min(n, chunk_));
+    }
+
+private:
+    std::streamsize chunk_;
+};
+
+std::string make_text()
+{
+    const char* const parts[] = {"Hello World! ",
+                                 "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d ",
+                                 "\xE3\x82\x84\xE3\x81\x82",
+                                 "\xf0\x9f\x98\x80",
+                                 "\xFF",
+                                 "\xE3\x82 ",
+                                 "\r\n",
+                                 "\r"};
+    std::string result;
+    for(std::size_t i = 0; i < 300; i++)
+        result += parts[(i * 5 + i / 7) % (sizeof(parts) / sizeof(parts[0]))];
+    return result;
+}
+
+template<typename CharOut>
+void test_read(const std::string& utf8, std::size_t block_size, std::streamsize chunk)
+{
+    const std::basic_string<CharOut> expected =
+      nowide::utf::convert_string<CharOut>(utf8.data(), utf8.data() + utf8.size());
+    chunked_stringbuf bytes(utf8, chunk);
+    nowide::transcoding_streambuf<CharOut> buf(&bytes, block_size);
+    TEST(buf.rdbuf() == &bytes);
+    std::basic_istream<CharOut> is(&buf);
+    const std::basic_string<CharOut> result((std::istreambuf_iterator<CharOut>(is)),
+                                            std::istreambuf_iterator<CharOut>());
+    TEST(result == expected);
+}
+
+template<typename CharOut>
+void test_write(const std::string& utf8, std::size_t block_size)
+{
+    const std::basic_string<CharOut> wide =
+      nowide::utf::convert_string<CharOut>(utf8.data(), utf8.data() + utf8.size());
+    const std::string expected = nowide::utf::convert_string<char>(wide.data(), wide.data() + wide.size());
+    {
+        std::stringbuf bytes;
+        {
+            nowide::transcoding_streambuf<CharOut> buf(&bytes, block_size);
+            std::basic_ostream<CharOut> os(&buf);
+            for(CharOut c : wide)
+                os.put(c);
+            TEST(os.flush());
+        }
+        TEST(bytes.str() == expected);
+    }
+    {
+        std::stringbuf bytes;
+        nowide::transcoding_streambuf<CharOut> buf(&bytes, block_size);
+        std::basic_ostream<CharOut> os(&buf);
+        os.write(wide.data(), static_cast<std::streamsize>(wide.size()));
+        TEST(os.flush());
+        TEST(bytes.str() == expected);
+    }
+}
+
+std::string replace_all(std::string s, const std::string& from, const std::string& to)
+{
+    for(std::size_t pos = s.find(from); pos != std::string::npos; pos = s.find(from, pos + to.size()))
+        s.replace(pos, from.size(), to);
+    return s;
+}
+
+template<typename CharOut>
+void test_crlf(const std::string& utf8, std::size_t block_size)
+{
+    const std::string lf = replace_all(utf8, "\r\n", "\n");
+    const std::basic_string<CharOut> wide_lf =
+      nowide::utf::convert_string<CharOut>(lf.data(), lf.data() + lf.size());
+    for(std::streamsize chunk : {1, 3, 1000000})
+    {
+        chunked_stringbuf bytes(utf8, chunk);
+        nowide::transcoding_streambuf<CharOut> buf(&bytes, block_size);
+        TEST(!buf.crlf());
+        buf.crlf(true);
+        TEST(buf.crlf());
+        std::basic_istream<CharOut> is(&buf);
+        const std::basic_string<CharOut> result((std::istreambuf_iterator<CharOut>(is)),
+                                                std::istreambuf_iterator<CharOut>());
+        TEST(result == wide_lf);
+    }
+    std::stringbuf bytes;
+    {
+        nowide::transcoding_streambuf<CharOut> buf(&bytes, block_size);
+        buf.crlf(true);
+        std::basic_ostream<CharOut> os(&buf);
+        os.write(wide_lf.data(), static_cast<std::streamsize>(wide_lf.size()));
+    }
+    const std::string expected = nowide::utf::convert_string<char>(wide_lf.data(), wide_lf.data() + wide_lf.size());
+    TEST(bytes.str() == replace_all(expected, "\n", "\r\n"));
+}
+
+template<typename CharOut>
+void test_all(const std::string& utf8)
+{
+    for(std::size_t block_size : {1, 16, 17, 64, 4096})
+    {
+        for(std::streamsize chunk : {1, 3, 1000000})
+            test_read<CharOut>(utf8, block_size, chunk);
+        test_write<CharOut>(utf8, block_size);
+        test_crlf<CharOut>(utf8, block_size);
+    }
+}
+
+void test_main(int, char**, char**)
+{
+    const std::string text = make_text();
+    std::cout << "-- UTF-16" << std::endl;
+    test_all<char16_t>(text);
+    std::cout << "-- UTF-32" << std::endl;
+    test_all<char32_t>(text);
+    std::cout << "-- wchar_t" << std::endl;
+    test_all<wchar_t>(text);
+    std::cout << "-- UTF-8" << std::endl;
+    test_all<char>(text);
+
+    {
+        std::cout << "-- Incomplete sequences at the end are replaced" << std::endl;
+        const char16_t replacement = NOWIDE_REPLACEMENT_CHARACTER;
+        std::stringbuf bytes("ab\xf0\x9f\x98");
+        nowide::transcoding_streambuf<char16_t> buf(&bytes);
+        std::u16string result;
+        for(auto c = buf.sgetc(); c != std::char_traits<char16_t>::eof(); c = buf.snextc())
+            result += std::char_traits<char16_t>::to_char_type(c);
+        TEST(result == (std::u16string{u'a', u'b', replacement}));
+
+        std::stringbuf out;
+        {
+            nowide::transcoding_streambuf<char16_t> obuf(&out);
+            obuf.sputc(u'a');
+            obuf.sputc(0xD83D);
+            TEST(obuf.pubsync() == 0);
+            // The high surrogate waits for its pair
+            TEST(out.str() == "a");
+        }
+        TEST(out.str() == "a\xEF\xBF\xBD");
+    }
+    {
+        std::cout << "-- No wrapped buffer" << std::endl;
+        nowide::wtranscoding_streambuf buf;
+        TEST(buf.sgetc() == std::char_traits<wchar_t>::eof());
+        TEST(buf.sputc(L'a') == std::char_traits<wchar_t>::eof());
+        std::stringbuf bytes("x");
+        TEST(buf.rdbuf(&bytes) == nullptr);
+        TEST(buf.sgetc() == L'x');
+    }
+}
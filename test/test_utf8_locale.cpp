@@ -0,0 +1,82 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/utf8_locale.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <nowide/convert.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+void test_main(int, char**, char**)
+{
+    const std::string hello = "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d \xf0\x9f\x98\x80";
+    const std::string filename = "nowide-test_utf8_locale.txt";
+
+    {
+        std::cout << "-- The locale is shared" << std::endl;
+        const std::locale& l = nowide::utf8_locale();
+        TEST(&l == &nowide::utf8_locale());
+        using wide_cvt = std::codecvt<wchar_t, char, std::mbstate_t>;
+        using utf16_cvt = std::codecvt<char16_t, char, std::mbstate_t>;
+        using utf32_cvt = std::codecvt<char32_t, char, std::mbstate_t>;
+        TEST(std::has_facet<wide_cvt>(l));
+        TEST(std::has_facet<utf16_cvt>(l));
+        TEST(std::has_facet<utf32_cvt>(l));
+        TEST(!std::use_facet<wide_cvt>(l).always_noconv());
+        TEST(dynamic_cast<const nowide::utf8_codecvt<char16_t>*>(&std::use_facet<utf16_cvt>(l)));
+        // Copies refer to the same locale
+        TEST(std::locale(l) == l);
+        TEST(l != std::locale::classic());
+    }
+    {
+        std::cout << "-- Initialization is thread safe" << std::endl;
+        std::vector<const std::locale*> results(8);
+        std::vector<std::thread> threads;
+        for(std::size_t i = 0; i < results.size(); i++)
+            threads.emplace_back([&results, i] { results[i] = &nowide::utf8_locale(); });
+        for(std::thread& t : threads)
+            t.join();
+        for(const std::locale* l : results)
+            TEST(l == &nowide::utf8_locale());
+    }
+    {
+        std::cout << "-- Imbued streams convert UTF-8" << std::endl;
+        {
+            std::wofstream f;
+            const std::locale previous = nowide::imbue_utf8(f);
+            TEST(previous != nowide::utf8_locale());
+            TEST(f.getloc() == nowide::utf8_locale());
+            f.open(filename.c_str());
+            TEST(f);
+            f << nowide::widen(hello);
+        }
+        {
+            std::ifstream f(filename.c_str(), std::ios::binary);
+            const std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+            TEST(content == hello);
+        }
+        {
+            std::wfilebuf buf;
+            nowide::imbue_utf8(buf);
+            TEST(buf.getloc() == nowide::utf8_locale());
+            TEST(buf.open(filename.c_str(), std::ios::in));
+            std::wistream f(&buf);
+            std::wstring line;
+            TEST(std::getline(f, line));
+            TEST(line == nowide::widen(hello));
+        }
+        std::remove(filename.c_str());
+    }
+}
@@ -0,0 +1,94 @@
+//
+//  Copyright (c) 2020 Berrysoft
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#include <nowide/wstring_convert.hpp>
+
+#include <cwchar>
+#include <iostream>
+#include <string>
+
+#include "test.hpp"
+#include "test_sets.hpp"
+
+nowide::wstring_convert<wchar_t>& shared_converter()
+{
+    static nowide::wstring_convert<wchar_t> instance;
+    return instance;
+}
+
+std::wstring wstring_convert_to_wide(const std::string& s)
+{
+    std::wstring result = shared_converter().from_bytes(s);
+    TEST(shared_converter().converted() == s.size());
+    return result;
+}
+
+std::string wstring_convert_to_narrow(const std::wstring& s)
+{
+    std::string result = shared_converter().to_bytes(s);
+    TEST(shared_converter().converted() == s.size());
+    return result;
+}
+
+void test_main(int, char**, char**)
+{
+    const std::string hello = "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d \xf0\x9f\x98\x80";
+    const std::u16string u16hello = u"\u05e9\u05dc\u05d5\u05dd \U0001F600";
+    const std::u32string u32hello = U"\u05e9\u05dc\u05d5\u05dd \U0001F600";
+
+    {
+        std::cout << "-- All overloads" << std::endl;
+        nowide::wstring_convert<char16_t> conv;
+        TEST(conv.from_bytes(hello) == u16hello);
+        TEST(conv.converted() == hello.size());
+        TEST(conv.from_bytes(hello.c_str()) == u16hello);
+        TEST(conv.from_bytes(hello.data(), hello.data() + 2) == u16hello.substr(0, 1));
+        TEST(conv.converted() == 2u);
+        TEST(conv.from_bytes('a') == u"a");
+        TEST(conv.to_bytes(u16hello) == hello);
+        TEST(conv.converted() == u16hello.size());
+        TEST(conv.to_bytes(u16hello.c_str()) == hello);
+        TEST(conv.to_bytes(u16hello.data(), u16hello.data() + 1) == hello.substr(0, 2));
+        TEST(conv.to_bytes(u'a') == "a");
+        TEST(conv.from_bytes("").empty());
+        TEST(conv.to_bytes(u"").empty());
+        TEST(conv.converted() == 0u);
+        std::mbstate_t state = conv.state();
+        TEST(std::mbsinit(&state));
+    }
+    {
+        std::cout << "-- UTF-32" << std::endl;
+        nowide::wstring_convert<char32_t> conv;
+        TEST(conv.from_bytes(hello) == u32hello);
+        TEST(conv.to_bytes(u32hello) == hello);
+    }
+    {
+        std::cout << "-- Views reuse the buffers" << std::endl;
+        nowide::wstring_convert<char16_t> conv;
+        const std::u16string_view first = conv.from_bytes_view(hello);
+        TEST(first == u16hello);
+        const std::u16string_view second = conv.from_bytes_view("abc");
+        TEST(second == u"abc");
+        TEST(second.data() == first.data());
+        const std::string_view bytes = conv.to_bytes_view(u16hello);
+        TEST(bytes == hello);
+        TEST(second == u"abc");
+        TEST(conv.to_bytes_view(u"xyz").data() == bytes.data());
+    }
+    {
+        std::cout << "-- Invalid input is replaced" << std::endl;
+        nowide::wstring_convert<char16_t> conv;
+        const std::string invalid = "a\xFF" "b\xE3\x82";
+        const char16_t replacement = NOWIDE_REPLACEMENT_CHARACTER;
+        const std::u16string expected = {u'a', replacement, u'b', replacement};
+        TEST(conv.from_bytes(invalid) == expected);
+        TEST(conv.converted() == invalid.size());
+    }
+    std::cout << "- wstring_convert" << std::endl;
+    run_all(wstring_convert_to_wide, wstring_convert_to_narrow);
+}